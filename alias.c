@@ -0,0 +1,333 @@
+#include "alias.h"
+#include "lottery.h"
+#include "proctable.h"
+#include "rng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define ALIAS_MAX_ATTEMPTS 64 // sorteios na tabela antes do sorteio exato entre os prontos
+
+// variaveis auxiliares
+const char nameAlias[] = "ALIA";
+int indexAlias = -1;
+SchedInfo *aliasSched = NULL; // informacoes registradas, com os contadores
+
+int *aliasRunnable = NULL; // handles dos processos prontos ou executando (participam do sorteio)
+int aliasNumRunnable = 0;		// quantidade de processos no conjunto
+int aliasCapacity = 0;			// capacidade alocada para o conjunto
+
+double *aliasProb = NULL; // probabilidade de ficar com a propria coluna
+int *aliasAlias = NULL;	  // coluna alternativa de cada coluna
+int64_t *aliasWeight = NULL; // tickets de cada coluna quando a tabela foi montada
+int aliasTableSize = 0;	  // quantidade de colunas da tabela atual
+int aliasTableCapacity = 0; // colunas alocadas
+int aliasDirty = 0;		  // 1 quando a tabela precisa ser refeita
+long aliasRebuilds = 0;	  // quantidade de reconstrucoes da tabela
+Rng aliasRng;			  // gerador usado nos sorteios
+pthread_mutex_t aliasLock = PTHREAD_MUTEX_INITIALIZER; // trava da tabela, do conjunto e do gerador
+
+/**
+ * @brief Funcao que verifica se um processo participa do sorteio
+ *
+ * A troca entre pronto e executando acontece a cada quantum, entao os dois estados
+ * ficam na tabela e so bloqueios, criacoes e remocoes invalidam a tabela.
+ *
+ * @param p processo
+ * @return int 1 caso participe e 0, caso contrario
+ */
+static int aliasIsRunnable(Process *p)
+{
+	int status = processGetStatus(p);
+	return status == PROC_READY || status == PROC_RUNNING;
+}
+
+/**
+ * @brief Funcao que insere um processo no conjunto de processos do sorteio
+ *
+ * @param p processo
+ * @param params parametros do processo
+ */
+static void aliasAdd(Process *p, LotterySchedParams *params)
+{
+	if (aliasNumRunnable == aliasCapacity) // dobra a capacidade
+	{
+		aliasCapacity = aliasCapacity ? aliasCapacity * 2 : 16;
+		aliasRunnable = realloc(aliasRunnable, aliasCapacity * sizeof(int));
+	}
+	params->index_pos = aliasNumRunnable;
+	aliasRunnable[aliasNumRunnable++] = processGetHandle(p);
+	aliasDirty = 1;
+}
+
+/**
+ * @brief Funcao que remove um processo do conjunto, trocando-o com o ultimo
+ *
+ * @param params parametros do processo
+ */
+static void aliasRemove(LotterySchedParams *params)
+{
+	int pos = params->index_pos;
+	int last = aliasRunnable[--aliasNumRunnable];
+	Process *lastp = processGetTable()->proc[last];
+
+	aliasRunnable[pos] = last;
+	((LotterySchedParams *)processGetSchedParams(lastp))->index_pos = pos;
+	params->index_pos = -1;
+	aliasDirty = 1;
+}
+
+/**
+ * @brief Funcao que reconstroi a tabela de alias pelo metodo de Vose em O(n)
+ *
+ * Os tickets sao lidos da coluna contigua da tabela de processos.
+ *
+ */
+static void aliasBuild(void)
+{
+	int64_t *tickets = processGetTable()->tickets;
+	int *small, *large;
+	int numSmall = 0, numLarge = 0;
+	int i, s, l, n = aliasNumRunnable;
+	double total = 0;
+
+	if (n > aliasTableCapacity) // so cresce
+	{
+		aliasTableCapacity = n;
+		aliasProb = realloc(aliasProb, n * sizeof(double));
+		aliasAlias = realloc(aliasAlias, n * sizeof(int));
+		aliasWeight = realloc(aliasWeight, n * sizeof(int64_t));
+	}
+	aliasTableSize = n;
+	aliasDirty = 0;
+	aliasRebuilds++;
+	SCHED_STATS(aliasSched)->rebuilds++;
+	SCHED_STATS(aliasSched)->scanned += n;
+
+	for (i = 0; i < n; i++)
+	{
+		aliasWeight[i] = tickets[aliasRunnable[i]];
+		total += aliasWeight[i];
+	}
+	if (total <= 0) // sem tickets, nao ha sorteio
+	{
+		aliasTableSize = 0;
+		return;
+	}
+
+	small = malloc(n * sizeof(int));
+	large = malloc(n * sizeof(int));
+
+	// probabilidade escalada: media 1 por coluna
+	for (i = 0; i < n; i++)
+	{
+		aliasProb[i] = (double)aliasWeight[i] * n / total;
+		aliasAlias[i] = i;
+		if (aliasProb[i] < 1.0)
+			small[numSmall++] = i;
+		else
+			large[numLarge++] = i;
+	}
+
+	// cada coluna pequena eh completada com a sobra de uma coluna grande
+	while (numSmall > 0 && numLarge > 0)
+	{
+		s = small[--numSmall];
+		l = large[--numLarge];
+		aliasAlias[s] = l;
+		aliasProb[l] -= 1.0 - aliasProb[s];
+		if (aliasProb[l] < 1.0)
+			small[numSmall++] = l;
+		else
+			large[numLarge++] = l;
+	}
+
+	// o que sobrar eh coluna cheia (erro de arredondamento)
+	while (numLarge > 0)
+		aliasProb[large[--numLarge]] = 1.0;
+	while (numSmall > 0)
+		aliasProb[small[--numSmall]] = 1.0;
+
+	free(small);
+	free(large);
+}
+
+/**
+ * @brief Funcao que realiza a inicializacao do escalonador com tabela de alias
+ *
+ */
+void aliasInitSchedInfo(void)
+{
+	SchedInfo *sched = malloc(sizeof(SchedInfo)); // cria o ponteiro
+
+	rngSeed(&aliasRng, LOTT_DEFAULT_SEED); // sequencia reproduzivel ate aliasSetSeed
+
+	// nome do escalonador
+	for (int i = 0; i < 4; i++)
+		sched->name[i] = nameAlias[i];
+
+	// funcoes necessarias para o escalonador funcionar
+	sched->initParamsFn = &aliasInitSchedParams;
+	sched->notifyProcStatusChangeFn = &aliasNotifyProcStatusChange;
+	sched->scheduleFn = &aliasSchedule;
+	sched->scheduleCpuFn = NULL; // todas as CPUs sorteiam na mesma tabela
+	sched->scheduleManyFn = NULL;
+	sched->chargeQuantumFn = NULL; // tabela refeita a cada mudanca de tickets, sem compensacao
+	sched->setNumCpusFn = NULL;
+	sched->releaseParamsFn = &aliasReleaseParams;
+
+	indexAlias = schedRegisterScheduler(sched); // registra o algoritmo de escalonamento
+	aliasSched = sched;
+}
+
+/**
+ * @brief Funcao que inicializa os parametros de escalonamento de um processo
+ *
+ * @param p processo
+ * @param params parametros (LotterySchedParams)
+ */
+void aliasInitSchedParams(Process *p, void *params)
+{
+	((LotterySchedParams *)params)->index_pos = -1; // ainda nao participa do sorteio
+	schedSetScheduler(p, params, indexAlias);
+	processSetTickets(p, ((LotterySchedParams *)params)->num_tickets);
+}
+
+/**
+ * @brief Funcao que recebe a notificacao que um processo mudou de estado ou de tickets
+ *
+ * @param p processo
+ */
+void aliasNotifyProcStatusChange(Process *p)
+{
+	LotterySchedParams *params = processGetSchedParams(p);
+
+	pthread_mutex_lock(&aliasLock);
+	if (aliasIsRunnable(p))
+	{
+		if (params->index_pos < 0) // entrou no sorteio
+			aliasAdd(p, params);
+		else if (!aliasDirty && aliasWeight[params->index_pos] != params->num_tickets)
+			aliasDirty = 1; // tickets alterados por transferencia
+		// alternar entre pronto e executando mantem a tabela valida
+	}
+	else if (params->index_pos >= 0) // bloqueou, sai do sorteio
+		aliasRemove(params);
+	pthread_mutex_unlock(&aliasLock);
+}
+
+/**
+ * @brief Funcao que sorteia exatamente entre os processos prontos do conjunto, em O(n)
+ *
+ * Usada quando os sorteios na tabela so encontram processos executando (por
+ * exemplo, um processo com quase todos os tickets ocupando outra CPU).
+ *
+ * @param table tabela de processos
+ * @return Process* processo sorteado ou NULL, caso nenhum pronto tenha tickets
+ */
+static Process *aliasExactPick(ProcTable *table)
+{
+	int64_t total = 0, drawn;
+	int i, h;
+
+	for (i = 0; i < aliasNumRunnable; i++) // tickets dos prontos
+	{
+		h = aliasRunnable[i];
+		if (__atomic_load_n(&table->status[h], __ATOMIC_ACQUIRE) == PROC_READY)
+			total += table->tickets[h];
+	}
+	SCHED_STATS(aliasSched)->scanned += aliasNumRunnable;
+	if (total <= 0)
+		return NULL;
+
+	drawn = (int64_t)rngBounded(&aliasRng, (uint64_t)total);
+	for (i = 0; i < aliasNumRunnable; i++) // dono do bilhete
+	{
+		h = aliasRunnable[i];
+		if (__atomic_load_n(&table->status[h], __ATOMIC_ACQUIRE) != PROC_READY)
+			continue;
+		if (drawn < table->tickets[h])
+			return table->proc[h];
+		drawn -= table->tickets[h];
+	}
+	return NULL; // status mudou entre as passadas; a CPU sorteia de novo
+}
+
+/**
+ * @brief Funcao que realiza o sorteio em O(1) pela tabela de alias
+ *
+ * @param plist processo
+ * @return Process* processo sorteado
+ */
+Process *aliasSchedule(Process *plist)
+{
+	ProcTable *table = processGetTable();
+	Process *winner = NULL;
+	double u; // numero aleatorio escalado para as colunas
+	int column, attempt;
+
+	pthread_mutex_lock(&aliasLock);
+	if (aliasDirty) // reconstrucao preguicosa
+		aliasBuild();
+
+	// com varias CPUs o sorteado pode estar executando em outra; sorteia de novo
+	for (attempt = 0; aliasTableSize > 0 && attempt < ALIAS_MAX_ATTEMPTS; attempt++)
+	{
+		// um unico numero aleatorio escolhe a coluna (parte inteira) e a moeda (parte fracionaria)
+		u = rngDouble(&aliasRng) * aliasTableSize;
+		column = (int)u;
+
+		if (u - column >= aliasProb[column])
+			column = aliasAlias[column];
+		SCHED_STATS(aliasSched)->scanned++;
+		if (__atomic_load_n(&table->status[aliasRunnable[column]], __ATOMIC_ACQUIRE) == PROC_READY)
+		{
+			winner = table->proc[aliasRunnable[column]];
+			break;
+		}
+	}
+	if (winner == NULL && aliasNumRunnable > 0) // so encontrou processos executando
+		winner = aliasExactPick(table);
+	pthread_mutex_unlock(&aliasLock);
+	return winner;
+}
+
+/**
+ * @brief Funcao que libera os parametros de escalonamento de um processo
+ *
+ * @param p processo
+ * @return int numero do slot do processo que ele estava associado
+ */
+int aliasReleaseParams(Process *p)
+{
+	int slot = processGetSchedSlot(p); // inicializa o slot
+
+	LotterySchedParams *params = processGetSchedParams(p); // inicializa os parametros
+	pthread_mutex_lock(&aliasLock);
+	if (params->index_pos >= 0) // se participa do sorteio, sai
+		aliasRemove(params);
+	pthread_mutex_unlock(&aliasLock);
+	lottFreeParams(params); // devolve ao pool
+
+	return slot;
+}
+
+/**
+ * @brief Funcao que retorna quantas vezes a tabela de alias foi reconstruida
+ *
+ * @return long numero de reconstrucoes
+ */
+long aliasGetRebuildCount(void)
+{
+	return aliasRebuilds;
+}
+
+/**
+ * @brief Funcao que reinicia o gerador de numeros aleatorios do escalonador
+ *
+ * @param seed semente
+ */
+void aliasSetSeed(uint64_t seed)
+{
+	rngSeed(&aliasRng, seed);
+}
@@ -0,0 +1,65 @@
+#ifndef ALIAS_H
+#define ALIAS_H
+
+#include <stdint.h>
+#include "scheduler.h"
+
+/*
+ * Escalonador por loteria com tabela de alias (Walker/Vose). Usa os mesmos
+ * parametros do escalonador por loteria (LotterySchedParams) e responde cada
+ * sorteio com um numero aleatorio e uma consulta a tabela, que so eh refeita
+ * quando o conjunto de processos prontos ou seus tickets mudam.
+ */
+
+/**
+ * @brief Funcao que realiza a inicializacao do escalonador com tabela de alias
+ *
+ */
+void aliasInitSchedInfo(void);
+
+/**
+ * @brief Funcao que inicializa os parametros de escalonamento de um processo
+ *
+ * @param p processo
+ * @param params parametros (LotterySchedParams)
+ */
+void aliasInitSchedParams(Process *p, void *params);
+
+/**
+ * @brief Funcao que recebe a notificacao que um processo mudou de estado ou de tickets
+ *
+ * @param p processo
+ */
+void aliasNotifyProcStatusChange(Process *p);
+
+/**
+ * @brief Funcao que realiza o sorteio em O(1) pela tabela de alias
+ *
+ * @param plist processo
+ * @return Process* processo sorteado
+ */
+Process *aliasSchedule(Process *plist);
+
+/**
+ * @brief Funcao que libera os parametros de escalonamento de um processo
+ *
+ * @param p processo
+ * @return int numero do slot do processo que ele estava associado
+ */
+int aliasReleaseParams(Process *p);
+
+/**
+ * @brief Funcao que retorna quantas vezes a tabela de alias foi reconstruida
+ *
+ * @return long numero de reconstrucoes
+ */
+long aliasGetRebuildCount(void);
+
+/**
+ * @brief Funcao que reinicia o gerador de numeros aleatorios do escalonador
+ *
+ * @param seed semente
+ */
+void aliasSetSeed(uint64_t seed);
+
+#endif
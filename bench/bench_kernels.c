@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../proctable.h"
+#include "../ticketkernels.h"
+#include "../rng.h"
+
+/*
+ * Vazao do sorteio linear sobre a tabela de processos (soma de prefixos dos
+ * prontos seguida da busca do bilhete), com o laco escalar e com os kernels
+ * vetorizados. Compilar a partir da raiz do projeto:
+ *
+ *   gcc -O2 -o bench_kernels bench/bench_kernels.c proctable.c ticketkernels.c rng.c -pthread
+ */
+
+/**
+ * @brief Funcao que retorna o tempo atual em segundos
+ *
+ * @return double tempo
+ */
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Funcao que libera as colunas de uma tabela de processos
+ *
+ * @param table tabela
+ */
+static void benchFreeTable(ProcTable *table)
+{
+	free(table->pid);
+	free(table->status);
+	free(table->sched_slot);
+	free(table->tickets);
+	free(table->proc);
+	free(table->free_handles);
+}
+
+/**
+ * @brief Funcao que mede quantos sorteios por segundo o kernel escolhido realiza
+ *
+ * @param table tabela
+ * @param prefix somas acumuladas
+ * @param draws quantidade de sorteios
+ * @param rng gerador dos bilhetes sorteados
+ * @return double sorteios por segundo
+ */
+static double benchDraws(ProcTable *table, int64_t *prefix, int draws, Rng *rng)
+{
+	double start = now();
+	int64_t total, checksum = 0;
+	int d;
+
+	for (d = 0; d < draws; d++)
+	{
+		total = ptabPrefixTickets(table, PROC_READY, prefix);
+		checksum += tkSearch(prefix, table->size, (int64_t)rngBounded(rng, (uint64_t)total));
+	}
+	if (checksum < 0) // evita que o laco seja descartado
+		printf("?");
+	return draws / (now() - start);
+}
+
+int main(void)
+{
+	int sizes[] = {1024, 65536, 1048576};
+	int isas[] = {TK_ISA_SCALAR, TK_ISA_AVX2, TK_ISA_AVX512};
+	int s, i, h, draws, isa;
+	ProcTable table;
+	int64_t *prefix;
+	Rng rng;
+
+	rngSeed(&rng, 42);
+	printf("%10s %8s %16s\n", "processos", "isa", "sorteios/s");
+	for (s = 0; s < 3; s++)
+	{
+		ptabInit(&table, sizes[s]);
+		for (h = 0; h < sizes[s]; h++)
+		{
+			ptabAlloc(&table, NULL);
+			table.status[h] = rngBounded(&rng, 2) ? PROC_READY : PROC_WAITING; // metade bloqueada
+			table.tickets[h] = ((int64_t)rngBounded(&rng, 100) + 1) * 100;
+		}
+		prefix = malloc(sizes[s] * sizeof(int64_t));
+		draws = (int)(200000000L / sizes[s]); // mesmo volume de trabalho por tamanho
+
+		for (i = 0; i < 3; i++)
+		{
+			isa = tkSetIsa(isas[i]);
+			if (isa != isas[i]) // CPU sem suporte
+				continue;
+			printf("%10d %8s %16.0f\n", sizes[s], tkGetIsaName(), benchDraws(&table, prefix, draws, &rng));
+		}
+		free(prefix);
+		benchFreeTable(&table);
+	}
+	return 0;
+}
@@ -0,0 +1,530 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "../process.h"
+#include "../scheduler.h"
+#include "../lottery.h"
+#include "../alias.h"
+#include "../stride.h"
+#include "../rng.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/*
+ * Microbenchmarks dos escalonadores registrados: para cada algoritmo, varre o
+ * tamanho do conjunto de prontos, a proporcao de processos aguardando e a taxa
+ * de transferencias, medindo ns por decisao, latencias p50/p99/p999, alocacoes
+ * e falhas de cache (perf_event_open, quando disponivel). Os resultados saem
+ * em JSON para comparacao entre versoes. Compilar a partir da raiz do projeto:
+ *
+ *   gcc -O2 -o bench_sched bench/bench_sched.c alias.c lottery.c pool.c process.c \
+ *       proctable.c rng.c scheduler.c snapshot.c stride.c ticketindex.c ticketkernels.c trace.c -pthread
+ *   ./bench_sched [--max N] [--decisoes N] [--tempo s] [--threads N] [--lote M] [--saida arquivo.json]
+ *
+ * Com --threads N, mede tambem a vazao de schedScheduleCpu com 1, 2, 4, ... ate
+ * N threads (uma CPU por thread) disputando o escalonador do primeiro slot.
+ * Com --lote M, compara em uma thread o quantum de 1, 2, 4, ... ate M CPUs
+ * decidido CPU a CPU (schedScheduleCpu) e em um unico sorteio (schedScheduleMany).
+ */
+
+#define BENCH_MAX_SLOTS 4		   // slots de escalonadores percorridos
+#define BENCH_LATENCY_SAMPLES 200000 // decisoes medidas individualmente
+#define BENCH_TRANSFERS 100000	   // transferencias medidas
+#define BENCH_THREAD_READY 10000	   // processos prontos na medicao com threads
+
+// configuracao de uma medicao
+typedef struct bench_case
+{
+	int ready;			  // processos prontos
+	double wait_ratio;	  // processos aguardando por processo pronto
+	double transfer_rate; // transferencias por decisao
+} BenchCase;
+
+// resultado de uma medicao
+typedef struct bench_result
+{
+	long decisions;		  // decisoes na medicao de vazao
+	double ns_decision;	  // media de ns por decisao
+	double p50, p99, p999; // latencias (ns)
+	long allocs;		  // alocacoes durante as decisoes (-1 se nao medido)
+	long long cache_misses; // falhas de cache durante as decisoes (-1 se indisponivel)
+	double ns_create;	  // media de ns por criacao
+	double ns_destroy;	  // media de ns por remocao
+	double ns_transfer;	  // media de ns por transferencia
+	PoolStats procs;	  // pool de processos depois da criacao
+	PoolStats params;	  // pool de parametros da loteria depois da criacao
+} BenchResult;
+
+long benchMaxReady = 1000000;  // maior conjunto de prontos
+long benchDecisions = 1000000; // decisoes por medicao de vazao
+double benchBudget = 0.5;	   // segundos maximos por medicao
+int benchThreads = 0;		   // threads maximas da medicao de disputa (0 desliga)
+int benchBatchCpus = 0;		   // CPUs maximas da medicao do sorteio em lote (0 desliga)
+Rng benchRng;
+
+#ifdef __GLIBC__
+// contagem de alocacoes: substitui as funcoes da libc neste binario
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+static long benchAllocs = 0;
+
+void *malloc(size_t size)
+{
+	benchAllocs++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size)
+{
+	benchAllocs++;
+	return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	benchAllocs++;
+	return __libc_realloc(ptr, size);
+}
+#define BENCH_ALLOCS() benchAllocs
+#else
+#define BENCH_ALLOCS() -1L
+#endif
+
+/**
+ * @brief Funcao que retorna o tempo atual em nanossegundos
+ *
+ * @return long long tempo
+ */
+static long long nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Funcao que abre o contador de falhas de cache da thread atual
+ *
+ * @return int descritor ou -1, caso o contador nao esteja disponivel
+ */
+static int perfOpen(void)
+{
+#ifdef __linux__
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+	return -1;
+#endif
+}
+
+/**
+ * @brief Funcao que zera e liga o contador
+ *
+ * @param fd descritor
+ */
+static void perfStart(int fd)
+{
+#ifdef __linux__
+	if (fd < 0)
+		return;
+	ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+}
+
+/**
+ * @brief Funcao que desliga o contador e retorna sua leitura
+ *
+ * @param fd descritor
+ * @return long long contagem ou -1, caso o contador nao esteja disponivel
+ */
+static long long perfStop(int fd)
+{
+	long long count = -1;
+#ifdef __linux__
+	if (fd < 0 || ioctl(fd, PERF_EVENT_IOC_DISABLE, 0) < 0 || read(fd, &count, sizeof(count)) != sizeof(count))
+		return -1;
+#endif
+	return count;
+}
+
+/**
+ * @brief Funcao de comparacao para ordenar as latencias
+ */
+static int cmpLong(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Funcao que cria um processo pronto associado ao escalonador de um slot
+ *
+ * @param plist processo
+ * @param si escalonador
+ * @return Process* processo criado
+ */
+static Process *benchCreate(Process *plist, SchedInfo *si)
+{
+	LotterySchedParams *params;
+
+	plist = processCreate(plist);
+	params = lottAllocParams();
+	params->num_tickets = ((int64_t)rngBounded(&benchRng, 100) + 1) * 100;
+	si->initParamsFn(plist, params);
+	processSetStatus(plist, PROC_READY);
+	return plist;
+}
+
+/**
+ * @brief Funcao que realiza uma decisao de escalonamento, como schedSchedule, para o escalonador de um slot
+ *
+ * Com processos aguardando, o processo que executava bloqueia e o primeiro
+ * aguardando volta a ficar pronto, mantendo a proporcao do cenario.
+ *
+ * @param si escalonador
+ * @param running processo em execucao (atualizado)
+ * @param c cenario
+ * @param procs processos do cenario
+ * @param n quantidade de processos
+ */
+static void benchDecide(SchedInfo *si, Process **running, const BenchCase *c, Process **procs, int n)
+{
+	Process *p;
+
+	if (*running != NULL)
+	{
+		if (c->wait_ratio > 0 && (p = processFirstByStatus(PROC_WAITING)) != NULL)
+		{
+			processSetStatus(*running, PROC_WAITING);
+			processSetStatus(p, PROC_READY);
+		}
+		else
+			processSetStatus(*running, PROC_READY);
+	}
+	if (c->transfer_rate > 0 && rngDouble(&benchRng) < c->transfer_rate)
+		lottTransferTickets(procs[rngBounded(&benchRng, n)], procs[rngBounded(&benchRng, n)],
+							(int64_t)rngBounded(&benchRng, 100) + 1);
+
+	*running = si->scheduleFn(NULL);
+	if (*running != NULL)
+		processSetStatus(*running, PROC_RUNNING);
+}
+
+/**
+ * @brief Funcao que mede um cenario para o escalonador de um slot
+ *
+ * @param si escalonador
+ * @param c cenario
+ * @param perfFd contador de falhas de cache
+ * @param r resultado
+ */
+static void benchRun(SchedInfo *si, const BenchCase *c, int perfFd, BenchResult *r)
+{
+	int waiting = (int)(c->ready * c->wait_ratio), n = c->ready + waiting, i;
+	Process **procs = malloc(n * sizeof(Process *));
+	Process *plist = NULL, *running = NULL;
+	long long *lat, start, t;
+	long samples, allocs;
+
+	// criacao: todos prontos e depois uma parte passa a aguardar
+	start = nowNs();
+	for (i = 0; i < n; i++)
+		procs[i] = plist = benchCreate(plist, si);
+	r->ns_create = (double)(nowNs() - start) / n;
+	processGetPoolStats(&r->procs);
+	lottGetParamsPoolStats(&r->params);
+	for (i = 0; i < waiting; i++)
+	{
+		processSetStatus(procs[i], PROC_RUNNING);
+		processSetStatus(procs[i], PROC_WAITING);
+	}
+
+	start = nowNs();
+	for (i = 0; i < 1000 && nowNs() - start < benchBudget * 1e8; i++) // aquecimento (ate 10% do tempo)
+		benchDecide(si, &running, c, procs, n);
+
+	// vazao: sem medicoes individuais, limitada pelo tempo
+	allocs = BENCH_ALLOCS();
+	perfStart(perfFd);
+	start = nowNs();
+	for (r->decisions = 0; r->decisions < benchDecisions;)
+	{
+		benchDecide(si, &running, c, procs, n);
+		if ((++r->decisions & 255) == 0 && nowNs() - start > benchBudget * 1e9)
+			break;
+	}
+	t = nowNs() - start;
+	r->cache_misses = perfStop(perfFd);
+	r->allocs = allocs < 0 ? -1 : BENCH_ALLOCS() - allocs;
+	r->ns_decision = (double)t / r->decisions;
+
+	// latencias: uma medicao por decisao
+	lat = malloc(BENCH_LATENCY_SAMPLES * sizeof(long long));
+	start = nowNs();
+	for (samples = 0; samples < BENCH_LATENCY_SAMPLES && nowNs() - start < benchBudget * 1e9; samples++)
+	{
+		t = nowNs();
+		benchDecide(si, &running, c, procs, n);
+		lat[samples] = nowNs() - t;
+	}
+	qsort(lat, samples, sizeof(long long), &cmpLong);
+	r->p50 = lat[samples / 2];
+	r->p99 = lat[samples * 99 / 100];
+	r->p999 = lat[samples * 999 / 1000];
+	free(lat);
+
+	// transferencias isoladas
+	start = nowNs();
+	for (i = 0; i < BENCH_TRANSFERS; i++)
+		lottTransferTickets(procs[rngBounded(&benchRng, n)], procs[rngBounded(&benchRng, n)],
+							(int64_t)rngBounded(&benchRng, 100) + 1);
+	r->ns_transfer = (double)(nowNs() - start) / BENCH_TRANSFERS;
+
+	// remocao de todos os processos
+	start = nowNs();
+	for (i = 0; i < n; i++)
+		plist = processDestroy(plist, processGetPid(procs[i]));
+	r->ns_destroy = (double)(nowNs() - start) / n;
+	free(procs);
+}
+
+// thread da medicao de disputa
+typedef struct bench_thread
+{
+	pthread_t thread;
+	int cpu;		   // CPU escalonada pela thread
+	Process **procs;   // processos do cenario
+	int n;			   // quantidade de processos
+	long long deadline; // fim da medicao (ns)
+	long decisions;	   // decisoes realizadas
+} BenchThread;
+
+/**
+ * @brief Funcao executada por cada thread: decisoes na sua CPU e transferencias entre processos quaisquer
+ *
+ * @param arg thread (BenchThread)
+ * @return void* NULL
+ */
+static void *benchThreadMain(void *arg)
+{
+	BenchThread *bt = arg;
+	Rng rng;
+
+	rngSeed(&rng, 42 + bt->cpu);
+	while (nowNs() < bt->deadline)
+	{
+		schedScheduleCpu(NULL, bt->cpu);
+		if (rngBounded(&rng, 10) == 0) // uma transferencia a cada dez decisoes
+			lottTransferTickets(bt->procs[rngBounded(&rng, bt->n)], bt->procs[rngBounded(&rng, bt->n)],
+								(int64_t)rngBounded(&rng, 100) + 1);
+		bt->decisions++;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Funcao que mede a vazao do escalonador do primeiro slot com varias threads decidindo ao mesmo tempo
+ *
+ * @param out arquivo JSON
+ * @param first 1 caso ainda nao haja resultados no arquivo
+ */
+static void benchContention(FILE *out, int first)
+{
+	BenchThread threads[SCHED_MAX_CPUS];
+	Process **procs = malloc(BENCH_THREAD_READY * sizeof(Process *));
+	Process *plist = NULL;
+	long decisions;
+	int n, i;
+
+	for (i = 0; i < BENCH_THREAD_READY; i++)
+		procs[i] = plist = benchCreate(plist, schedGetSchedInfo(0));
+	for (n = 1; n <= benchThreads && n <= SCHED_MAX_CPUS; n *= 2)
+	{
+		// CPUs configuradas antes das threads comecarem
+		schedSetNumCpus(n);
+		for (i = 0; i < n; i++)
+		{
+			threads[i].cpu = i;
+			threads[i].procs = procs;
+			threads[i].n = BENCH_THREAD_READY;
+			threads[i].deadline = nowNs() + (long long)(benchBudget * 1e9);
+			threads[i].decisions = 0;
+			pthread_create(&threads[i].thread, NULL, &benchThreadMain, &threads[i]);
+		}
+		for (i = decisions = 0; i < n; i++)
+		{
+			pthread_join(threads[i].thread, NULL);
+			decisions += threads[i].decisions;
+		}
+
+		fprintf(stderr, "%s threads %2d: %12.0f decisoes/s\n", schedGetSchedInfo(0)->name, n, decisions / benchBudget);
+		fprintf(out, "%s  {\"escalonador\": \"%s\", \"threads\": %d, \"prontos\": %d, \"decisoes\": %ld, "
+					 "\"decisoes_por_s\": %.0f}",
+				first ? "" : ",\n", schedGetSchedInfo(0)->name, n, BENCH_THREAD_READY, decisions, decisions / benchBudget);
+		first = 0;
+	}
+	for (i = 0; i < BENCH_THREAD_READY; i++)
+		plist = processDestroy(plist, processGetPid(procs[i]));
+	free(procs);
+}
+
+/**
+ * @brief Funcao que mede quanta de varias CPUs decididos CPU a CPU e em um unico sorteio em lote
+ *
+ * @param out arquivo JSON
+ * @param first 1 caso ainda nao haja resultados no arquivo
+ * @return int 1 caso ainda nao haja resultados no arquivo
+ */
+static int benchBatch(FILE *out, int first)
+{
+	Process **procs = malloc(BENCH_THREAD_READY * sizeof(Process *));
+	Process *won[SCHED_MAX_CPUS], *plist = NULL;
+	long long start, deadline, t[2];
+	long quanta[2];
+	int n, i, mode;
+
+	schedSetNumCpus(1); // filas vazias, reduzidas antes de criar os processos
+	for (i = 0; i < BENCH_THREAD_READY; i++)
+		procs[i] = plist = benchCreate(plist, schedGetSchedInfo(0));
+	for (n = 1; n <= benchBatchCpus && n <= SCHED_MAX_CPUS; n *= 2)
+	{
+		schedSetNumCpus(n);
+		for (mode = 0; mode < 2; mode++) // 0: CPU a CPU; 1: em lote
+		{
+			start = nowNs();
+			deadline = start + (long long)(benchBudget * 1e9);
+			for (quanta[mode] = 0; (quanta[mode] & 255) || nowNs() < deadline; quanta[mode]++)
+			{
+				if (mode)
+					schedScheduleMany(NULL, won, n);
+				else
+					for (i = 0; i < n; i++)
+						schedScheduleCpu(NULL, i);
+			}
+			t[mode] = nowNs() - start;
+		}
+
+		fprintf(stderr, "%s lote %2d CPUs: %10.1f ns/quantum por CPU, %10.1f ns/quantum em lote\n",
+				schedGetSchedInfo(0)->name, n, (double)t[0] / quanta[0], (double)t[1] / quanta[1]);
+		fprintf(out, "%s  {\"escalonador\": \"%s\", \"cpus\": %d, \"prontos\": %d, "
+					 "\"ns_quantum_por_cpu\": %.1f, \"ns_quantum_em_lote\": %.1f}",
+				first ? "" : ",\n", schedGetSchedInfo(0)->name, n, BENCH_THREAD_READY,
+				(double)t[0] / quanta[0], (double)t[1] / quanta[1]);
+		first = 0;
+	}
+	for (i = 0; i < BENCH_THREAD_READY; i++)
+		plist = processDestroy(plist, processGetPid(procs[i]));
+	free(procs);
+	return first;
+}
+
+/**
+ * @brief Funcao que escreve um numero inteiro em JSON, com null para valores indisponiveis
+ *
+ * @param out arquivo
+ * @param key chave
+ * @param value valor (negativo para indisponivel)
+ */
+static void jsonCount(FILE *out, const char *key, long long value)
+{
+	if (value < 0)
+		fprintf(out, ", \"%s\": null", key);
+	else
+		fprintf(out, ", \"%s\": %lld", key, value);
+}
+
+int main(int argc, char *argv[])
+{
+	double waitRatios[] = {0, 1};
+	double transferRates[] = {0, 0.1};
+	const char *path = NULL;
+	FILE *out = stdout;
+	SchedInfo *si;
+	BenchCase c;
+	BenchResult r;
+	int slot, w, t, perfFd, first = 1;
+	long ready;
+
+	for (w = 1; w + 1 < argc; w += 2)
+	{
+		if (!strcmp(argv[w], "--max"))
+			benchMaxReady = atol(argv[w + 1]);
+		else if (!strcmp(argv[w], "--decisoes"))
+			benchDecisions = atol(argv[w + 1]);
+		else if (!strcmp(argv[w], "--tempo"))
+			benchBudget = atof(argv[w + 1]);
+		else if (!strcmp(argv[w], "--threads"))
+			benchThreads = atoi(argv[w + 1]);
+		else if (!strcmp(argv[w], "--lote"))
+			benchBatchCpus = atoi(argv[w + 1]);
+		else if (!strcmp(argv[w], "--saida"))
+			path = argv[w + 1];
+	}
+	if (path != NULL && (out = fopen(path, "w")) == NULL)
+	{
+		fprintf(stderr, "Nao foi possivel criar %s\n", path);
+		return 1;
+	}
+
+	rngSeed(&benchRng, 42);
+	schedInitSchedInfo();
+	lottInitSchedInfo();
+	aliasInitSchedInfo();
+	strdInitSchedInfo();
+	lottSetVerbose(0);
+	perfFd = perfOpen();
+
+	fprintf(out, "[\n");
+	for (slot = 0; slot < BENCH_MAX_SLOTS && (si = schedGetSchedInfo(slot)) != NULL; slot++)
+		for (ready = 10; ready <= benchMaxReady; ready *= 10)
+			for (w = 0; w < 2; w++)
+				for (t = 0; t < 2; t++)
+				{
+					c.ready = (int)ready;
+					c.wait_ratio = waitRatios[w];
+					c.transfer_rate = transferRates[t];
+					benchRun(si, &c, perfFd, &r);
+
+					fprintf(stderr, "%s prontos %8d aguardando/pronto %.1f transf %.2f: %10.1f ns/decisao p99 %8.0f ns\n",
+							si->name, c.ready, c.wait_ratio, c.transfer_rate, r.ns_decision, r.p99);
+					fprintf(out, "%s  {\"escalonador\": \"%s\", \"prontos\": %d, \"aguardando_por_pronto\": %.2f, "
+								 "\"taxa_transferencia\": %.2f, \"decisoes\": %ld, \"ns_por_decisao\": %.1f, "
+								 "\"p50_ns\": %.0f, \"p99_ns\": %.0f, \"p999_ns\": %.0f",
+							first ? "" : ",\n", si->name, c.ready, c.wait_ratio, c.transfer_rate, r.decisions,
+							r.ns_decision, r.p50, r.p99, r.p999);
+					jsonCount(out, "alocacoes", r.allocs);
+					jsonCount(out, "falhas_cache", r.cache_misses);
+					fprintf(out, ", \"pool_processos_em_uso\": %ld, \"pool_processos_maximo\": %ld, "
+								 "\"pool_parametros_em_uso\": %ld, \"pool_parametros_maximo\": %ld",
+							r.procs.live, r.procs.high_water, r.params.live, r.params.high_water);
+					fprintf(out, ", \"ns_criacao\": %.1f, \"ns_remocao\": %.1f, \"ns_transferencia\": %.1f}",
+							r.ns_create, r.ns_destroy, r.ns_transfer);
+					first = 0;
+				}
+	if (benchBatchCpus > 0)
+		first = benchBatch(out, first);
+	if (benchThreads > 0)
+		benchContention(out, first);
+	fprintf(out, "\n]\n");
+
+	if (out != stdout)
+		fclose(out);
+	return 0;
+}
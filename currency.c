@@ -0,0 +1,440 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "currency.h"
+#include "lottery.h"
+#include "trace.h"
+
+struct currency
+{
+	char name[CURR_MAX_NAME_LEN];
+	Currency *parent;	 // moeda que financia esta (NULL = tickets base)
+	int64_t funding;	 // tickets da moeda pai que financiam esta
+	int64_t issued;		 // tickets emitidos (processos e moedas filhas)
+	int64_t value;		 // valor do financiamento em tickets base (guardado)
+	Process **holders;	 // processos que detem tickets da moeda
+	int numHolders;		 // quantidade de processos
+	int capHolders;		 // capacidade alocada
+	Currency **children; // moedas financiadas por esta
+	int numChildren;	 // quantidade de moedas filhas
+	int capChildren;	 // capacidade alocada
+};
+
+// colunas indexadas pelo handle do processo
+Currency **currHolderOf = NULL; // moeda do processo ou NULL
+int64_t *currAmount = NULL;		// tickets da moeda
+int *currHolderPos = NULL;		// posicao em holders da moeda
+int currCapacity = 0;			// handles alocados
+
+long currUpdates = 0; // valores recalculados
+pthread_mutex_t currLock = PTHREAD_MUTEX_INITIALIZER; // trava do grafo de moedas e das colunas
+
+/**
+ * @brief Funcao que garante espaco nas colunas para um handle
+ *
+ * @param handle handle do processo
+ */
+static void currReserve(int handle)
+{
+	int capacity = currCapacity ? currCapacity : 64, i;
+
+	if (handle < currCapacity)
+		return;
+	while (capacity <= handle) // dobra a capacidade
+		capacity *= 2;
+	currHolderOf = realloc(currHolderOf, capacity * sizeof(Currency *));
+	currAmount = realloc(currAmount, capacity * sizeof(int64_t));
+	currHolderPos = realloc(currHolderPos, capacity * sizeof(int));
+	for (i = currCapacity; i < capacity; i++)
+	{
+		currHolderOf[i] = NULL;
+		currAmount[i] = 0;
+	}
+	currCapacity = capacity;
+}
+
+/**
+ * @brief Funcao que converte tickets de uma moeda em tickets base pela taxa guardada
+ *
+ * @param c moeda
+ * @param amount tickets da moeda
+ * @return int64_t tickets base (pelo menos 1 para quantia positiva de moeda com valor)
+ */
+static int64_t currToBase(Currency *c, int64_t amount)
+{
+	__int128 base;
+
+	if (c->issued <= 0 || amount <= 0 || c->value <= 0)
+		return 0;
+	base = (__int128)amount * c->value / c->issued;
+	if (base > INT64_MAX)
+		return INT64_MAX;
+	return base > 0 ? (int64_t)base : 1; // quantia pequena nao fica sem chance
+}
+
+/**
+ * @brief Funcao que atualiza os tickets de um processo para o valor da sua quantia na moeda
+ *
+ * @param c moeda
+ * @param p processo
+ */
+static void currUpdateHolder(Currency *c, Process *p)
+{
+	LotterySchedParams *params = processGetSchedParams(p);
+	int64_t base = currToBase(c, currAmount[processGetHandle(p)]);
+
+	if (base != params->num_tickets)
+		lottInflateTickets(p, base - params->num_tickets);
+	currUpdates++;
+}
+
+/**
+ * @brief Funcao que recalcula o valor de uma moeda e de tudo que ela financia
+ *
+ * Percorre apenas a subarvore da moeda; o resto do grafo mantem os valores guardados.
+ *
+ * @param c moeda
+ */
+static void currRevalue(Currency *c)
+{
+	int i;
+
+	c->value = c->parent ? currToBase(c->parent, c->funding) : c->funding;
+	currUpdates++;
+	for (i = 0; i < c->numHolders; i++)
+		currUpdateHolder(c, c->holders[i]);
+	for (i = 0; i < c->numChildren; i++)
+		currRevalue(c->children[i]);
+}
+
+/**
+ * @brief Funcao que retorna a moeda de um processo (com a trava das moedas)
+ *
+ * @param p processo
+ * @return Currency* moeda ou NULL, caso o processo nao detenha moeda
+ */
+static Currency *currFind(Process *p)
+{
+	int handle = processGetHandle(p);
+	return handle < currCapacity ? currHolderOf[handle] : NULL;
+}
+
+/**
+ * @brief Funcao que retira um processo da sua moeda (com a trava das moedas)
+ *
+ * @param p processo
+ */
+static void currDetach(Process *p)
+{
+	int handle = processGetHandle(p), pos;
+	Currency *c = currFind(p);
+
+	if (c == NULL)
+		return;
+	pos = currHolderPos[handle];
+	c->holders[pos] = c->holders[--c->numHolders]; // o ultimo ocupa a posicao
+	currHolderPos[processGetHandle(c->holders[pos])] = pos;
+	c->issued -= currAmount[handle];
+	currHolderOf[handle] = NULL;
+	currAmount[handle] = 0;
+	currRevalue(c);
+}
+
+/**
+ * @brief Funcao que cria uma moeda financiada pela moeda pai
+ *
+ * @param name nome da moeda
+ * @param parent moeda pai ou NULL, caso seja financiada com tickets base
+ * @param funding tickets da moeda pai que financiam a nova moeda
+ * @return Currency* moeda criada ou NULL, caso os parametros sejam invalidos
+ */
+Currency *currCreate(const char *name, Currency *parent, int64_t funding)
+{
+	Currency *c;
+	int64_t issued;
+
+	if (funding < 0)
+		return NULL;
+	c = calloc(1, sizeof(Currency));
+	if (c == NULL)
+		return NULL;
+	strncpy(c->name, name, CURR_MAX_NAME_LEN - 1);
+	c->parent = parent;
+	c->funding = funding;
+
+	pthread_mutex_lock(&currLock);
+	if (parent == NULL)
+	{
+		currRevalue(c);
+		pthread_mutex_unlock(&currLock);
+		return c;
+	}
+	if (__builtin_add_overflow(parent->issued, funding, &issued))
+	{
+		pthread_mutex_unlock(&currLock);
+		free(c);
+		return NULL;
+	}
+	if (parent->numChildren == parent->capChildren) // dobra a capacidade
+	{
+		parent->capChildren = parent->capChildren ? parent->capChildren * 2 : 4;
+		parent->children = realloc(parent->children, parent->capChildren * sizeof(Currency *));
+	}
+	parent->children[parent->numChildren++] = c;
+	parent->issued += funding;
+	currRevalue(parent); // a emissao dilui as irmas
+	pthread_mutex_unlock(&currLock);
+	return c;
+}
+
+/**
+ * @brief Funcao que destroi uma moeda sem processos nem moedas filhas
+ *
+ * @param c moeda
+ * @return int 1 caso a moeda seja destruida e -1, caso contrario
+ */
+int currDestroy(Currency *c)
+{
+	Currency *parent = c->parent;
+	int i;
+
+	pthread_mutex_lock(&currLock);
+	if (c->numHolders > 0 || c->numChildren > 0)
+	{
+		pthread_mutex_unlock(&currLock);
+		return -1;
+	}
+	if (parent)
+	{
+		for (i = 0; parent->children[i] != c; i++)
+			;
+		parent->children[i] = parent->children[--parent->numChildren];
+		parent->issued -= c->funding;
+		currRevalue(parent);
+	}
+	pthread_mutex_unlock(&currLock);
+	free(c->holders);
+	free(c->children);
+	free(c);
+	return 1;
+}
+
+/**
+ * @brief Funcao que altera o financiamento de uma moeda, recalculando a subarvore da moeda pai
+ *
+ * @param c moeda
+ * @param delta tickets da moeda pai acrescentados (ou retirados, se negativo)
+ * @return int64_t novo financiamento ou -1, caso fique negativo
+ */
+int64_t currFund(Currency *c, int64_t delta)
+{
+	int64_t funding, issued;
+
+	pthread_mutex_lock(&currLock);
+	if (__builtin_add_overflow(c->funding, delta, &funding) || funding < 0 ||
+		(c->parent && __builtin_add_overflow(c->parent->issued, delta, &issued)))
+	{
+		pthread_mutex_unlock(&currLock);
+		return -1;
+	}
+	c->funding = funding;
+	if (c->parent == NULL) // financiada com tickets base: so a propria subarvore muda
+		currRevalue(c);
+	else
+	{
+		c->parent->issued += delta;
+		currRevalue(c->parent);
+	}
+	pthread_mutex_unlock(&currLock);
+	return funding;
+}
+
+/**
+ * @brief Funcao que coloca um processo como detentor de tickets de uma moeda
+ *
+ * @param c moeda
+ * @param p processo
+ * @param amount tickets da moeda
+ * @return int 1 caso o processo passe a deter a moeda e -1, caso contrario
+ */
+int currIssue(Currency *c, Process *p, int64_t amount)
+{
+	int handle = processGetHandle(p);
+	int64_t issued;
+
+	if (amount < 0 || processGetSchedParams(p) == NULL)
+		return -1;
+	pthread_mutex_lock(&currLock);
+	if (__builtin_add_overflow(c->issued, amount, &issued))
+	{
+		pthread_mutex_unlock(&currLock);
+		return -1;
+	}
+	currReserve(handle);
+	if (currHolderOf[handle] != NULL) // troca de moeda
+		currDetach(p);
+
+	if (c->numHolders == c->capHolders) // dobra a capacidade
+	{
+		c->capHolders = c->capHolders ? c->capHolders * 2 : 8;
+		c->holders = realloc(c->holders, c->capHolders * sizeof(Process *));
+	}
+	currHolderPos[handle] = c->numHolders;
+	c->holders[c->numHolders++] = p;
+	currHolderOf[handle] = c;
+	currAmount[handle] = amount;
+	c->issued += amount;
+	currRevalue(c);
+	pthread_mutex_unlock(&currLock);
+	return 1;
+}
+
+/**
+ * @brief Funcao que infla (ou deflaciona) os tickets que um processo tem na sua moeda
+ *
+ * @param p processo
+ * @param delta tickets da moeda acrescentados
+ * @return int64_t novo numero de tickets da moeda ou -1, caso seja invalido
+ */
+int64_t currInflate(Process *p, int64_t delta)
+{
+	int handle = processGetHandle(p);
+	Currency *c;
+	int64_t amount, issued;
+
+	pthread_mutex_lock(&currLock);
+	c = currFind(p);
+	if (c == NULL || __builtin_add_overflow(currAmount[handle], delta, &amount) || amount < 0 ||
+		__builtin_add_overflow(c->issued, delta, &issued))
+	{
+		pthread_mutex_unlock(&currLock);
+		return -1;
+	}
+	currAmount[handle] = amount;
+	c->issued += delta;
+	currRevalue(c); // so a moeda do processo muda de taxa
+	pthread_mutex_unlock(&currLock);
+	return amount;
+}
+
+/**
+ * @brief Funcao que transfere tickets da moeda entre dois processos da mesma moeda
+ *
+ * @param src processo de origem
+ * @param dst processo de destino
+ * @param amount tickets da moeda pedidos
+ * @return int64_t tickets transferidos ou -1, caso os processos nao tenham a mesma moeda
+ */
+int64_t currTransfer(Process *src, Process *dst, int64_t amount)
+{
+	Currency *c;
+	int from = processGetHandle(src), to = processGetHandle(dst);
+	SchedInfo *sched; // escalonador da origem, para os contadores
+
+	pthread_mutex_lock(&currLock);
+	c = currFind(src);
+	if (c == NULL || currFind(dst) != c || amount < 0)
+	{
+		pthread_mutex_unlock(&currLock);
+		return -1;
+	}
+	if (amount > currAmount[from])
+		amount = currAmount[from];
+	currAmount[from] -= amount; // a soma emitida pela moeda continua a mesma
+	currAmount[to] += amount;
+	currUpdateHolder(c, src);
+	currUpdateHolder(c, dst);
+	pthread_mutex_unlock(&currLock);
+	if ((sched = schedGetSchedInfo(processGetSchedSlot(src))) != NULL)
+		SCHED_STATS(sched)->transfers++;
+	TRACE(TRACE_TRANSFER, 0, processGetPid(src), processGetPid(dst), amount);
+	return amount;
+}
+
+/**
+ * @brief Funcao que retira um processo da sua moeda (deve ser chamada antes de destrui-lo)
+ *
+ * @param p processo
+ */
+void currRelease(Process *p)
+{
+	pthread_mutex_lock(&currLock);
+	currDetach(p);
+	pthread_mutex_unlock(&currLock);
+}
+
+/**
+ * @brief Funcao que retorna a moeda de um processo
+ *
+ * @param p processo
+ * @return Currency* moeda ou NULL, caso o processo nao detenha moeda
+ */
+Currency *currOf(Process *p)
+{
+	Currency *c;
+
+	pthread_mutex_lock(&currLock);
+	c = currFind(p);
+	pthread_mutex_unlock(&currLock);
+	return c;
+}
+
+/**
+ * @brief Funcao que retorna quantos tickets da moeda um processo tem
+ *
+ * @param p processo
+ * @return int64_t tickets da moeda ou 0, caso o processo nao detenha moeda
+ */
+int64_t currGetAmount(Process *p)
+{
+	int handle = processGetHandle(p);
+	int64_t amount;
+
+	pthread_mutex_lock(&currLock);
+	amount = handle < currCapacity ? currAmount[handle] : 0;
+	pthread_mutex_unlock(&currLock);
+	return amount;
+}
+
+/**
+ * @brief Funcao que retorna a taxa de cambio guardada de uma moeda
+ *
+ * @param c moeda
+ * @return double tickets base por ticket da moeda
+ */
+double currGetRate(Currency *c)
+{
+	return c->issued > 0 ? (double)c->value / c->issued : 0.0;
+}
+
+/**
+ * @brief Funcao que retorna o valor em tickets base do financiamento de uma moeda
+ *
+ * @param c moeda
+ * @return int64_t valor em tickets base
+ */
+int64_t currGetValue(Currency *c)
+{
+	return c->value;
+}
+
+/**
+ * @brief Funcao que retorna quantos tickets a moeda emitiu (processos e moedas filhas)
+ *
+ * @param c moeda
+ * @return int64_t tickets emitidos
+ */
+int64_t currGetIssued(Currency *c)
+{
+	return c->issued;
+}
+
+/**
+ * @brief Funcao que retorna quantos valores em tickets base foram recalculados
+ *
+ * @return long processos e moedas recalculados desde o inicio
+ */
+long currGetUpdates(void)
+{
+	return currUpdates;
+}
@@ -0,0 +1,138 @@
+#ifndef CURRENCY_H
+#define CURRENCY_H
+
+#include <stdint.h>
+#include "process.h"
+
+/*
+ * Moedas de tickets (Waldspurger): um grupo (usuario, cliente) financia sua
+ * moeda com tickets da moeda pai, ou com tickets base quando nao tem pai, e
+ * emite tickets proprios para seus processos e moedas filhas. O valor em
+ * tickets base de cada processo fica guardado nos parametros de loteria, de
+ * modo que o sorteio nunca percorre o grafo de moedas; inflar ou financiar uma
+ * moeda so recalcula a subarvore afetada.
+ */
+
+#define CURR_MAX_NAME_LEN 16
+
+typedef struct currency Currency;
+
+/**
+ * @brief Funcao que cria uma moeda financiada pela moeda pai
+ *
+ * @param name nome da moeda
+ * @param parent moeda pai ou NULL, caso seja financiada com tickets base
+ * @param funding tickets da moeda pai que financiam a nova moeda
+ * @return Currency* moeda criada ou NULL, caso os parametros sejam invalidos
+ */
+Currency *currCreate(const char *name, Currency *parent, int64_t funding);
+
+/**
+ * @brief Funcao que destroi uma moeda sem processos nem moedas filhas
+ *
+ * @param c moeda
+ * @return int 1 caso a moeda seja destruida e -1, caso contrario
+ */
+int currDestroy(Currency *c);
+
+/**
+ * @brief Funcao que altera o financiamento de uma moeda, recalculando a subarvore da moeda pai
+ *
+ * @param c moeda
+ * @param delta tickets da moeda pai acrescentados (ou retirados, se negativo)
+ * @return int64_t novo financiamento ou -1, caso fique negativo
+ */
+int64_t currFund(Currency *c, int64_t delta);
+
+/**
+ * @brief Funcao que coloca um processo como detentor de tickets de uma moeda
+ *
+ * O processo ja deve estar associado a um escalonador que use LotterySchedParams;
+ * seus tickets passam a ser o valor em tickets base do que ele tem na moeda.
+ *
+ * @param c moeda
+ * @param p processo
+ * @param amount tickets da moeda
+ * @return int 1 caso o processo passe a deter a moeda e -1, caso contrario
+ */
+int currIssue(Currency *c, Process *p, int64_t amount);
+
+/**
+ * @brief Funcao que infla (ou deflaciona) os tickets que um processo tem na sua moeda
+ *
+ * So a moeda do processo eh recalculada: as demais moedas nao mudam de valor.
+ *
+ * @param p processo
+ * @param delta tickets da moeda acrescentados
+ * @return int64_t novo numero de tickets da moeda ou -1, caso seja invalido
+ */
+int64_t currInflate(Process *p, int64_t delta);
+
+/**
+ * @brief Funcao que transfere tickets da moeda entre dois processos da mesma moeda
+ *
+ * A quantia emitida nao muda, entao a taxa de cambio continua a mesma e so os
+ * dois processos sao recalculados.
+ *
+ * @param src processo de origem
+ * @param dst processo de destino
+ * @param amount tickets da moeda pedidos
+ * @return int64_t tickets transferidos ou -1, caso os processos nao tenham a mesma moeda
+ */
+int64_t currTransfer(Process *src, Process *dst, int64_t amount);
+
+/**
+ * @brief Funcao que retira um processo da sua moeda (deve ser chamada antes de destrui-lo)
+ *
+ * @param p processo
+ */
+void currRelease(Process *p);
+
+/**
+ * @brief Funcao que retorna a moeda de um processo
+ *
+ * @param p processo
+ * @return Currency* moeda ou NULL, caso o processo nao detenha moeda
+ */
+Currency *currOf(Process *p);
+
+/**
+ * @brief Funcao que retorna quantos tickets da moeda um processo tem
+ *
+ * @param p processo
+ * @return int64_t tickets da moeda ou 0, caso o processo nao detenha moeda
+ */
+int64_t currGetAmount(Process *p);
+
+/**
+ * @brief Funcao que retorna a taxa de cambio guardada de uma moeda
+ *
+ * @param c moeda
+ * @return double tickets base por ticket da moeda
+ */
+double currGetRate(Currency *c);
+
+/**
+ * @brief Funcao que retorna o valor em tickets base do financiamento de uma moeda
+ *
+ * @param c moeda
+ * @return int64_t valor em tickets base
+ */
+int64_t currGetValue(Currency *c);
+
+/**
+ * @brief Funcao que retorna quantos tickets a moeda emitiu (processos e moedas filhas)
+ *
+ * @param c moeda
+ * @return int64_t tickets emitidos
+ */
+int64_t currGetIssued(Currency *c);
+
+/**
+ * @brief Funcao que retorna quantos valores em tickets base foram recalculados
+ *
+ * @return long processos e moedas recalculados desde o inicio
+ */
+long currGetUpdates(void);
+
+#endif
@@ -1,25 +1,172 @@
 #include "lottery.h"
+#include "ticketindex.h"
+#include "proctable.h"
+#include "pool.h"
+#include "rng.h"
+#include "trace.h"
 #include <stdio.h>
 #include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
 
 // variaveis auxiliares
 const char nameLottery[] = "LOTT";
 int indexLottery = -1;
-int distributedTickets = 0;
-int totalTickets;
+SchedInfo *lottSched = NULL; // informacoes registradas, com os contadores
+Pool lottParamsPool; // pool com os parametros de escalonamento
+int lottParamsPoolReady = 0;
+pthread_mutex_t lottParamsLock = PTHREAD_MUTEX_INITIALIZER; // pool usado por varias threads
+int64_t lottTicketSupply = 0; // tickets e compensacoes de todos os processos do escalonador (prontos ou nao)
+
+// fila de uma CPU (uma linha de cache por fila, sem falso compartilhamento das travas)
+typedef struct lott_cpu
+{
+	TicketIndex index;		 // indice com os tickets dos processos prontos da fila
+	Rng rng;				 // gerador usado nos sorteios da CPU
+	pthread_spinlock_t lock; // trava do indice e dos parametros dos processos da fila
+} __attribute__((aligned(64))) LottCpu;
+
+LottCpu lottCpus[SCHED_MAX_CPUS];
+int lottNumCpus = 0;
+int lottNextCpu = 0;						// distribuicao dos processos novos entre as filas
+long lottSteals = 0;						// processos roubados de outras filas
+Rng lottBatchRng;							// gerador do sorteio em lote (sob as travas de todas as filas)
+uint64_t lottSeed = LOTT_DEFAULT_SEED;		// semente de onde derivam os geradores das CPUs
+int lottVerbose = 1;						// 1 para imprimir cada bilhete sorteado
+
+/**
+ * @brief Funcao que deriva o gerador de uma CPU a partir da semente, com uma sequencia independente
+ *
+ * @param cpu numero da CPU
+ */
+static void lottSeedCpu(int cpu)
+{
+	int i;
+	rngSeed(&lottCpus[cpu].rng, lottSeed);
+	for (i = 0; i < cpu; i++) // cada CPU fica 2^128 passos a frente da anterior
+		rngJump(&lottCpus[cpu].rng);
+}
+
+/**
+ * @brief Funcao que deriva o gerador do sorteio em lote, depois das sequencias de todas as CPUs
+ *
+ */
+static void lottSeedBatch(void)
+{
+	int i;
+	rngSeed(&lottBatchRng, lottSeed);
+	for (i = 0; i < SCHED_MAX_CPUS; i++)
+		rngJump(&lottBatchRng);
+}
+
+/**
+ * @brief Funcao que retorna o total de tickets de uma fila sem trava-la (valor aproximado sob disputa)
+ *
+ * @param cpu numero da CPU
+ * @return int64_t total de tickets
+ */
+static int64_t lottQueueTotal(int cpu)
+{
+	return __atomic_load_n(&lottCpus[cpu].index.total, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Funcao que trava a fila atual de um processo
+ *
+ * O roubo pode mover o processo entre a leitura da fila e a trava, entao a
+ * fila eh conferida de novo depois de travada.
+ *
+ * @param params parametros do processo
+ * @return int fila travada
+ */
+static int lottLockQueueOf(LotterySchedParams *params)
+{
+	int cpu;
+
+	for (;;)
+	{
+		cpu = __atomic_load_n(&params->cpu, __ATOMIC_ACQUIRE);
+		if (cpu >= lottNumCpus) // fila removida por lottSetNumCpus (o processo nao esta em indice)
+		{
+			__atomic_store_n(&params->cpu, cpu % lottNumCpus, __ATOMIC_RELEASE);
+			continue;
+		}
+		pthread_spin_lock(&lottCpus[cpu].lock);
+		if (__atomic_load_n(&params->cpu, __ATOMIC_RELAXED) == cpu)
+			return cpu;
+		pthread_spin_unlock(&lottCpus[cpu].lock); // roubado no meio, tenta a nova fila
+	}
+}
 
 /**
- * @brief funcao que realiza a soma dos tickets dos processos prontos
+ * @brief Funcao que soma ao total de tickets do escalonador sem trava
+ *
+ * @param delta tickets acrescentados (ou retirados)
+ * @return int 1 caso a soma caiba em 64 bits e 0, caso contrario
+ */
+static int lottAddSupply(int64_t delta)
+{
+	int64_t supply = __atomic_load_n(&lottTicketSupply, __ATOMIC_RELAXED), updated;
+
+	do
+	{
+		if (__builtin_add_overflow(supply, delta, &updated))
+			return 0;
+	} while (!__atomic_compare_exchange_n(&lottTicketSupply, &supply, updated, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	return 1;
+}
+
+/**
+ * @brief Funcao que retorna o peso de um processo no indice: tickets e compensacao
+ *
+ * @param params parametros do processo
+ * @return int64_t peso (limitado a 64 bits)
+ */
+static int64_t lottWeight(LotterySchedParams *params)
+{
+	int64_t weight;
+
+	if (__builtin_add_overflow(params->num_tickets, params->compensation, &weight))
+		return INT64_MAX;
+	return weight;
+}
+
+/**
+ * @brief Funcao que repassa a alteracao de tickets de um processo para o seu escalonador
+ *
+ * Outros escalonadores que usam LotterySchedParams (como o de tabela de alias)
+ * sao avisados pela notificacao de mudanca de estado.
  *
  * @param p processo
+ * @param params parametros do processo
+ */
+static void lottNotifyTicketChange(Process *p, LotterySchedParams *params)
+{
+	int cpu;
+
+	processSetTickets(p, params->num_tickets); // coluna de tickets da tabela de processos
+	if (processGetSchedSlot(p) != indexLottery)
+	{
+		schedNotifyProcStatusChange(p);
+		return;
+	}
+	cpu = lottLockQueueOf(params);
+	if (params->index_pos >= 0)
+		tidxUpdate(&lottCpus[cpu].index, params->index_pos, lottWeight(params));
+	pthread_spin_unlock(&lottCpus[cpu].lock);
+}
+
+/**
+ * @brief Funcao que soma aos contadores do escalonador o trabalho feito em um indice
+ *
+ * @param idx indice
+ * @param rebuilds reconstrucoes do indice antes do sorteio
+ * @param scanned nos percorridos no indice antes do sorteio
  */
-void addTickProcess(Process *p)
+static void lottAccount(TicketIndex *idx, long rebuilds, long scanned)
 {
-	LotterySchedParams *params;				   // cria o ponteiro
-	params = processGetSchedParams(p);		   // pega os parametros
-	params->num_minor_ticket = totalTickets;   // recebe os tickets
-	totalTickets += params->num_tickets;	   // soma os tickets
-	params->num_greater_ticket = totalTickets; // recebe os tickets
+	SCHED_STATS(lottSched)->rebuilds += tidxGetRebuilds(idx) - rebuilds;
+	SCHED_STATS(lottSched)->scanned += tidxGetScanned(idx) - scanned;
 }
 
 /**
@@ -30,7 +177,8 @@ void lottInitSchedInfo()
 {
 	SchedInfo *sched = malloc(sizeof(SchedInfo)); // cria o ponteiro
 
-	totalTickets = 0; // inicializa o total de tickets
+	lottSetNumCpus(1); // uma fila ate lottSetNumCpus
+	lottSeedBatch();
 
 	// nome do escalonador
 	for (int i = 0; i < 4; i++)
@@ -40,9 +188,14 @@ void lottInitSchedInfo()
 	sched->initParamsFn = &lottInitSchedParams;
 	sched->notifyProcStatusChangeFn = &lottNotifyProcStatusChange;
 	sched->scheduleFn = &lottSchedule;
+	sched->scheduleCpuFn = &lottScheduleCpu;
+	sched->scheduleManyFn = &lottScheduleMany;
+	sched->chargeQuantumFn = &lottChargeQuantum;
+	sched->setNumCpusFn = &lottSetNumCpus; // uma fila por CPU
 	sched->releaseParamsFn = &lottReleaseParams;
 
 	indexLottery = schedRegisterScheduler(sched); // registra o algoritmo de escalonamento
+	lottSched = sched;
 }
 
 /**
@@ -53,7 +206,13 @@ void lottInitSchedInfo()
  */
 void lottInitSchedParams(Process *p, void *params)
 {
+	((LotterySchedParams *)params)->index_pos = -1;					   // ainda nao esta no indice
+	((LotterySchedParams *)params)->compensation = 0;
+	((LotterySchedParams *)params)->cpu = // filas recebem processos em rodizio
+		(int)((unsigned int)__atomic_fetch_add(&lottNextCpu, 1, __ATOMIC_RELAXED) % (unsigned int)lottNumCpus);
 	schedSetScheduler(p, params, indexLottery);
+	processSetTickets(p, ((LotterySchedParams *)params)->num_tickets);
+	lottAddSupply(((LotterySchedParams *)params)->num_tickets);
 }
 
 /**
@@ -63,14 +222,27 @@ void lottInitSchedParams(Process *p, void *params)
  */
 void lottNotifyProcStatusChange(Process *p)
 {
-	LotterySchedParams *params; // ponteiro para os parametros
+	LotterySchedParams *params = processGetSchedParams(p); // ponteiro para os parametros
 
 	int status = processGetStatus(p); // retorna o estatus do processo
+	int cpu = lottLockQueueOf(params); // fila do processo, travada
 
 	if (status == PROC_READY) // se o processo estiver pronto
-		addTickProcess(p);	  // chama a funcao que adiciona os tickets
-	else
-		distributedTickets = 1;
+	{
+		if (params->index_pos < 0) // entra no indice com seus tickets
+			params->index_pos = tidxInsert(&lottCpus[cpu].index, p, lottWeight(params));
+	}
+	else if (params->index_pos >= 0) // deixou de estar pronto, sai do indice
+	{
+		tidxRemove(&lottCpus[cpu].index, params->index_pos);
+		params->index_pos = -1;
+	}
+	if (status == PROC_RUNNING && params->compensation > 0) // a compensacao vale ate o processo voltar a executar
+	{
+		lottAddSupply(-params->compensation);
+		params->compensation = 0;
+	}
+	pthread_spin_unlock(&lottCpus[cpu].lock);
 }
 
 /**
@@ -81,51 +253,260 @@ void lottNotifyProcStatusChange(Process *p)
  */
 Process *lottSchedule(Process *plist)
 {
-	Process *p = plist;			  // ponteiro para o processo atual
-	Process *drawnProcess = NULL; // ponteiro para o processo sorteado
+	return lottScheduleCpu(plist, 0); // fila da primeira CPU
+}
+
+/**
+ * @brief Funcao que rouba para uma CPU um processo pronto de outra fila
+ *
+ * A fila vitima eh sorteada com probabilidade proporcional ao seu total de
+ * tickets e o processo eh sorteado dentro dela, entao cada processo pronto
+ * tem chance proporcional aos seus tickets. O processo passa para a fila da CPU.
+ *
+ * @param cpu numero da CPU
+ * @return Process* processo roubado ou NULL, caso nao haja processos prontos
+ */
+static Process *lottSteal(int cpu)
+{
+	LottCpu *thief = &lottCpus[cpu], *from;
+	LotterySchedParams *params;
+	Process *p;
+	int64_t totals[SCHED_MAX_CPUS], total = 0, drawn;
+	long rebuilds, scanned;
+	int victim, first, second;
+
+	for (victim = 0; victim < lottNumCpus; victim++) // totais das filas, sem trava-las
+		total += totals[victim] = lottQueueTotal(victim);
+	if (total <= 0) // nenhum processo pronto em nenhuma fila
+		return NULL;
 
-	LotterySchedParams *params; // ponteiro para os parametros
+	drawn = (int64_t)rngBounded(&thief->rng, (uint64_t)total);
+	for (victim = 0; drawn >= totals[victim]; victim++) // fila dona do bilhete
+		drawn -= totals[victim];
+	SCHED_STATS(lottSched)->scanned += lottNumCpus + victim + 1; // filas somadas e percorridas
 
-	int drawn_ticket = -1; // bilhete sorteado
+	// trava as duas filas na ordem dos numeros, sem risco de impasse
+	first = victim < cpu ? victim : cpu;
+	second = victim < cpu ? cpu : victim;
+	pthread_spin_lock(&lottCpus[first].lock);
+	if (second != first)
+		pthread_spin_lock(&lottCpus[second].lock);
 
-	// se ja distribuiu os tickets
-	if (distributedTickets == 1)
+	from = &lottCpus[victim];
+	p = NULL;
+	if (tidxTotal(&from->index) > 0) // a fila pode ter mudado depois da leitura dos totais
 	{
-		Process *proc;					// cria o ponteiro para o processo
-		LotterySchedParams *procParams; // cria o ponteiro para os parametros
-		totalTickets = 0;
+		if (drawn >= tidxTotal(&from->index))
+			drawn = (int64_t)rngBounded(&thief->rng, (uint64_t)tidxTotal(&from->index));
+		rebuilds = tidxGetRebuilds(&from->index);
+		scanned = tidxGetScanned(&from->index);
+		p = tidxFind(&from->index, drawn);
+		lottAccount(&from->index, rebuilds, scanned);
 
-		// laco para rodar por toda a lista de processos
-		for (proc = plist; proc != NULL; proc = processGetNext(proc))
+		if (victim != cpu) // migra o processo para a fila da CPU que roubou
 		{
-			if (processGetStatus(proc) == PROC_READY) // se o processo estiver pronto
-				addTickProcess(proc);				  // adiciona os tickets
+			params = processGetSchedParams(p);
+			tidxRemove(&from->index, params->index_pos);
+			__atomic_store_n(&params->cpu, cpu, __ATOMIC_RELEASE);
+			params->index_pos = tidxInsert(&thief->index, p, lottWeight(params));
+			__atomic_fetch_add(&lottSteals, 1, __ATOMIC_RELAXED);
 		}
+	}
+
+	if (second != first)
+		pthread_spin_unlock(&lottCpus[second].lock);
+	pthread_spin_unlock(&lottCpus[first].lock);
+	return p;
+}
+
+/**
+ * @brief Funcao que realiza o escalonamento por loteria na fila de uma CPU
+ *
+ * @param plist processo
+ * @param cpu numero da CPU
+ * @return Process* processo sorteado
+ */
+Process *lottScheduleCpu(Process *plist, int cpu)
+{
+	LottCpu *c;
+	int64_t totalTickets;						 // total de tickets dos processos prontos da fila
+	int64_t drawn_ticket = -1;					 // bilhete sorteado
+	Process *winner;							 // processo sorteado
+	long rebuilds, scanned;						 // contadores do indice antes do sorteio
 
-		distributedTickets = 0;
+	if (cpu < 0 || cpu >= lottNumCpus) // CPU sem fila
+		return NULL;
+	c = &lottCpus[cpu];
+	pthread_spin_lock(&c->lock);
+	totalTickets = tidxTotal(&c->index);
+	if (totalTickets <= 0) // fila vazia, tenta roubar de outra CPU
+	{
+		pthread_spin_unlock(&c->lock);
+		return lottSteal(cpu);
 	}
 
-	drawn_ticket = rand() % totalTickets; // sorteia o numero aleatorio entre 0 e o total de tickets
+	drawn_ticket = (int64_t)rngBounded(&c->rng, (uint64_t)totalTickets); // sorteia sem vies entre 0 e o total de tickets
 
-	printf("Numero aleatorio: %d\n", drawn_ticket); // imprime na tela
+	if (lottVerbose)
+		printf("Numero aleatorio: %" PRId64 "\n", drawn_ticket); // imprime na tela
 
-	// laco para rodar por toda a lista de processos
-	for (p = plist; p != NULL; p = processGetNext(p))
+	rebuilds = tidxGetRebuilds(&c->index);
+	scanned = tidxGetScanned(&c->index);
+	winner = tidxFind(&c->index, drawn_ticket); // desce a arvore ate o processo sorteado
+	lottAccount(&c->index, rebuilds, scanned);
+	pthread_spin_unlock(&c->lock);
+	TRACE(TRACE_DRAW, cpu, processGetPid(winner), drawn_ticket, totalTickets);
+	return winner;
+}
+
+/**
+ * @brief Funcao que sorteia varios processos distintos de uma vez, sem reposicao
+ *
+ * Cada sorteado tem seus tickets zerados temporariamente no indice da sua fila,
+ * entao os proximos sorteios nao podem repeti-lo; ao final os tickets sao
+ * devolvidos. O custo eh O(M log n) para M sorteados.
+ *
+ * @param plist processo
+ * @param winners saida com os processos sorteados
+ * @param m quantidade desejada
+ * @return int quantidade sorteada (menor que m se faltarem processos prontos)
+ */
+int lottScheduleMany(Process *plist, Process **winners, int m)
+{
+	Rng *rng = &lottBatchRng; // gerador proprio, sem disputar o de uma CPU
+	int cpus[SCHED_MAX_CPUS], pos[SCHED_MAX_CPUS];
+	int64_t weight[SCHED_MAX_CPUS];
+	int64_t total, drawn;
+	long rebuilds, scanned;
+	int n, i, cpu;
+
+	if (m > SCHED_MAX_CPUS)
+		m = SCHED_MAX_CPUS;
+
+	for (i = 0; i < lottNumCpus; i++) // o lote sorteia em todas as filas, travadas em ordem
+		pthread_spin_lock(&lottCpus[i].lock);
+	total = lottGetTotalTickets();
+	for (n = 0; n < m && total > 0; n++)
 	{
-		if (processGetStatus(p) == PROC_READY) // se o processo estiver pronto
-		{
-			params = processGetSchedParams(p); // pega seus parametros
+		drawn = (int64_t)rngBounded(rng, (uint64_t)total);
+		for (cpu = 0; drawn >= tidxTotal(&lottCpus[cpu].index); cpu++) // fila dona do bilhete
+			drawn -= tidxTotal(&lottCpus[cpu].index);
+
+		SCHED_STATS(lottSched)->scanned += cpu + 1;
+		rebuilds = tidxGetRebuilds(&lottCpus[cpu].index);
+		scanned = tidxGetScanned(&lottCpus[cpu].index);
+		cpus[n] = cpu;
+		pos[n] = tidxFindPos(&lottCpus[cpu].index, drawn);
+		lottAccount(&lottCpus[cpu].index, rebuilds, scanned);
+		weight[n] = tidxWeight(&lottCpus[cpu].index, pos[n]);
+		winners[n] = tidxItem(&lottCpus[cpu].index, pos[n]);
+
+		tidxUpdate(&lottCpus[cpu].index, pos[n], 0); // retira o sorteado dos proximos sorteios
+		total -= weight[n];
+	}
+
+	for (i = n - 1; i >= 0; i--) // devolve os tickets dos sorteados
+		tidxUpdate(&lottCpus[cpus[i]].index, pos[i], weight[i]);
+	for (i = lottNumCpus - 1; i >= 0; i--)
+		pthread_spin_unlock(&lottCpus[i].lock);
+
+	return n;
+}
 
-			if (drawn_ticket >= params->num_minor_ticket &&
-				drawn_ticket < params->num_greater_ticket) // verifica a soma e caso ele for o sorteado
+/**
+ * @brief Funcao que define quantas filas (CPUs) o escalonador mantem
+ *
+ * Os processos prontos das filas removidas sao reinseridos nas que ficam.
+ *
+ * @param n quantidade de CPUs
+ * @return int quantidade definida e -1, caso seja invalida
+ */
+int lottSetNumCpus(int n)
+{
+	LotterySchedParams *params;
+	Process *p;
+	int i, k, old = lottNumCpus, moved = 0;
+
+	if (n < 1 || n > SCHED_MAX_CPUS)
+		return -1;
+
+	if (n < old) // processos das filas removidas passam, em rodizio, para as que ficam
+	{
+		for (i = 0; i < old; i++) // todas as filas travadas em ordem, como no lote
+			pthread_spin_lock(&lottCpus[i].lock);
+		for (i = n; i < old; i++)
+			for (k = 0; k < lottCpus[i].index.size; k++)
 			{
-				drawnProcess = p; // ele eh o processo sorteado
-				break;
+				if ((p = tidxItem(&lottCpus[i].index, k)) == NULL)
+					continue;
+				params = processGetSchedParams(p);
+				params->index_pos = tidxInsert(&lottCpus[moved % n].index, p, lottWeight(params));
+				__atomic_store_n(&params->cpu, moved++ % n, __ATOMIC_RELEASE);
 			}
-		}
+		__atomic_store_n(&lottNumCpus, n, __ATOMIC_RELEASE);
+		for (i = old - 1; i >= 0; i--)
+			pthread_spin_unlock(&lottCpus[i].lock);
+	}
+
+	for (i = n; i < old; i++)
+	{
+		tidxFree(&lottCpus[i].index);
+		pthread_spin_destroy(&lottCpus[i].lock);
+	}
+	for (i = old; i < n; i++) // filas novas
+	{
+		tidxInit(&lottCpus[i].index, 16);
+		pthread_spin_init(&lottCpus[i].lock, PTHREAD_PROCESS_PRIVATE);
+		lottSeedCpu(i);
 	}
+	lottNumCpus = n;
+	lottNextCpu %= n;
+	return n;
+}
 
-	return drawnProcess; // retorna o processo sorteado
+/**
+ * @brief Funcao que retorna quantos processos foram roubados de outras filas
+ *
+ * @return long numero de roubos
+ */
+long lottGetStealCount(void)
+{
+	return __atomic_load_n(&lottSteals, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Funcao que concede tickets de compensacao a um processo que usou so parte do quantum
+ *
+ * A compensacao entra no total do escalonador e eh limitada ao que ainda cabe nele.
+ *
+ * @param p processo
+ * @param used fracao usada do quantum, entre 0 e SCHED_QUANTUM_UNITS
+ */
+void lottChargeQuantum(Process *p, int used)
+{
+	LotterySchedParams *params = processGetSchedParams(p);
+	__int128 grant = 0;
+	int64_t compensation, room;
+	int cpu;
+
+	if (used < 1) // fracao minima, para 1/f ser finito
+		used = 1;
+	if (used < SCHED_QUANTUM_UNITS) // tickets / f - tickets
+		grant = (__int128)params->num_tickets * (SCHED_QUANTUM_UNITS - used) / used;
+	compensation = grant > INT64_MAX ? INT64_MAX : (int64_t)grant;
+
+	cpu = lottLockQueueOf(params);
+	if (!lottAddSupply(compensation - params->compensation)) // total cheio: concede so o que cabe
+	{
+		room = INT64_MAX - __atomic_load_n(&lottTicketSupply, __ATOMIC_RELAXED);
+		compensation = params->compensation + (lottAddSupply(room) ? room : 0);
+	}
+	params->compensation = compensation;
+	if (params->index_pos >= 0) // ja esta pronto: so a sua posicao muda
+		tidxUpdate(&lottCpus[cpu].index, params->index_pos, lottWeight(params));
+	pthread_spin_unlock(&lottCpus[cpu].lock);
+	if (compensation > 0)
+		SCHED_STATS(lottSched)->compensations++;
 }
 
 /**
@@ -139,7 +520,14 @@ int lottReleaseParams(Process *p)
 	int slot = processGetSchedSlot(p); // inicializa o slot
 
 	LotterySchedParams *params = processGetSchedParams(p); // inicializa os parametros
-	free(params);										   // desaloca
+	int cpu = lottLockQueueOf(params);
+
+	if (params->index_pos >= 0) // se estiver no indice, remove
+		tidxRemove(&lottCpus[cpu].index, params->index_pos);
+	params->index_pos = -1;
+	pthread_spin_unlock(&lottCpus[cpu].lock);
+	lottAddSupply(-params->num_tickets - params->compensation); // compensacao pendente tambem sai do total
+	lottFreeParams(params); // devolve ao pool
 
 	return slot;
 }
@@ -150,26 +538,331 @@ int lottReleaseParams(Process *p)
  * @param src processo origem
  * @param dst processo destino
  * @param tickets numero de tickets
- * @return int numero de tickets que foi transferido
+ * @return int64_t numero de tickets que foi transferido
  */
-int lottTransferTickets(Process *src, Process *dst, int tickets)
+int64_t lottTransferTickets(Process *src, Process *dst, int64_t tickets)
 {
-	int transfer; // tickets transferidos
+	int64_t transfer; // tickets transferidos
+	SchedInfo *sched; // escalonador da origem, para os contadores
+	Process *first, *second; // processos na ordem de trava
 
 	// pega os paramentros dos dois processos
 	LotterySchedParams *proc1 = processGetSchedParams(src);
 	LotterySchedParams *proc2 = processGetSchedParams(dst);
 
+	// trava os dois processos na ordem dos handles, sem risco de impasse
+	first = processGetHandle(src) < processGetHandle(dst) ? src : dst;
+	second = first == src ? dst : src;
+	processLockProc(first);
+	if (second != first)
+		processLockProc(second);
+
 	// realiza a verificacao para a transferencia
 	if (proc1->num_tickets < tickets)
 		transfer = proc1->num_tickets;
 	else
 		transfer = tickets;
+	if (transfer < 0) // nao transfere tickets negativos
+		transfer = 0;
+	if (transfer > INT64_MAX - proc2->num_tickets) // destino nao pode estourar 64 bits
+		transfer = INT64_MAX - proc2->num_tickets;
 
 	// tira de um processo e adiciona no outro
 	proc1->num_tickets -= transfer;
 	proc2->num_tickets += transfer;
 
-	distributedTickets = 1;
+	// atualiza somente as posicoes dos dois processos no indice
+	lottNotifyTicketChange(src, proc1);
+	lottNotifyTicketChange(dst, proc2);
+	if (second != first)
+		processUnlockProc(second);
+	processUnlockProc(first);
+	if ((sched = schedGetSchedInfo(processGetSchedSlot(src))) != NULL)
+		SCHED_STATS(sched)->transfers++;
+	TRACE(TRACE_TRANSFER, 0, processGetPid(src), processGetPid(dst), transfer);
+
 	return transfer;
 }
+
+/**
+ * @brief Funcao que realiza a inflacao (ou deflacao, com delta negativo) dos tickets de um processo
+ *
+ * @param p processo
+ * @param delta quantidade de tickets criados (ou destruidos)
+ * @return int64_t novo numero de tickets do processo e -1, caso a operacao seja recusada
+ */
+int64_t lottInflateTickets(Process *p, int64_t delta)
+{
+	LotterySchedParams *params = processGetSchedParams(p);
+	int64_t tickets;
+
+	processLockProc(p);
+	if (__builtin_add_overflow(params->num_tickets, delta, &tickets) || tickets < 0 ||
+		(processGetSchedSlot(p) == indexLottery && !lottAddSupply(delta)))
+	{
+		processUnlockProc(p);
+		return -1; // estouro, tickets negativos ou total do escalonador fora de 64 bits
+	}
+
+	params->num_tickets = tickets;
+	lottNotifyTicketChange(p, params);
+	processUnlockProc(p);
+	return tickets;
+}
+
+/**
+ * @brief Funcao que retorna o total de tickets dos processos prontos, mantido por deltas
+ *
+ * @return int64_t total de tickets
+ */
+int64_t lottGetTotalTickets(void)
+{
+	int64_t total = 0;
+	int i;
+	for (i = 0; i < lottNumCpus; i++) // soma das filas
+		total += lottQueueTotal(i);
+	return total;
+}
+
+/**
+ * @brief Funcao que retorna quantas vezes o indice de tickets foi reconstruido por completo
+ *
+ * @return long numero de reconstrucoes
+ */
+long lottGetRebuildCount(void)
+{
+	long rebuilds = 0;
+	int i;
+	for (i = 0; i < lottNumCpus; i++) // soma das filas
+		rebuilds += tidxGetRebuilds(&lottCpus[i].index);
+	return rebuilds;
+}
+
+/**
+ * @brief Funcao que inicializa o pool de parametros de escalonamento
+ *
+ * @param prealloc quantidade de parametros pre-alocados
+ * @param flags opcoes do pool (POOL_HUGEPAGES ou 0)
+ */
+void lottInitParamsPool(long prealloc, int flags)
+{
+	pthread_mutex_lock(&lottParamsLock);
+	if (!lottParamsPoolReady) // ja existem parametros no pool atual
+		poolInit(&lottParamsPool, sizeof(LotterySchedParams), prealloc, flags);
+	lottParamsPoolReady = 1;
+	pthread_mutex_unlock(&lottParamsLock);
+}
+
+/**
+ * @brief Funcao que aloca os parametros de escalonamento de um processo
+ *
+ * @return LotterySchedParams* parametros
+ */
+LotterySchedParams *lottAllocParams(void)
+{
+	LotterySchedParams *params;
+
+	if (!lottParamsPoolReady) // pool sem pre-alocacao caso lottInitParamsPool nao tenha sido chamada
+		lottInitParamsPool(0, 0);
+	pthread_mutex_lock(&lottParamsLock);
+	params = poolAlloc(&lottParamsPool);
+	pthread_mutex_unlock(&lottParamsLock);
+	return params;
+}
+
+/**
+ * @brief Funcao que devolve ao pool os parametros de escalonamento de um processo
+ *
+ * @param params parametros
+ */
+void lottFreeParams(LotterySchedParams *params)
+{
+	pthread_mutex_lock(&lottParamsLock);
+	poolFree(&lottParamsPool, params);
+	pthread_mutex_unlock(&lottParamsLock);
+}
+
+/**
+ * @brief Funcao que preenche as estatisticas do pool de parametros
+ *
+ * @param stats estatisticas
+ */
+void lottGetParamsPoolStats(PoolStats *stats)
+{
+	poolGetStats(&lottParamsPool, stats);
+}
+
+/**
+ * @brief Funcao que reinicia o gerador de numeros aleatorios do escalonador
+ *
+ * @param seed semente
+ */
+void lottSetSeed(uint64_t seed)
+{
+	int i;
+	lottSeed = seed;
+	for (i = 0; i < lottNumCpus; i++) // geradores independentes por CPU
+		lottSeedCpu(i);
+	lottSeedBatch();
+}
+
+// cabecalho da secao da loteria no instantaneo
+typedef struct lott_snap_info
+{
+	int64_t supply;	  // tickets e compensacoes de todos os processos do escalonador
+	uint64_t seed;	  // semente de onde derivam os geradores
+	int32_t num_cpus; // filas
+	int32_t next_cpu; // proxima fila de um processo novo
+	int32_t size;	  // handles da tabela de processos
+	int32_t reserved;
+} LottSnapInfo;
+
+/**
+ * @brief Funcao que grava no instantaneo os parametros dos processos, as filas, os indices e os geradores
+ *
+ * @param s instantaneo em gravacao
+ * @return int 1 caso a secao seja gravada e 0, caso algum processo seja de outro escalonador
+ */
+int lottSave(Snapshot *s)
+{
+	ProcTable *table = processGetTable();
+	LottSnapInfo info = {lottTicketSupply, lottSeed, lottNumCpus, lottNextCpu, table->size, 0};
+	LotterySchedParams *params;
+	int64_t *tickets = calloc(table->size + 1, sizeof(int64_t));
+	int64_t *compensation = calloc(table->size + 1, sizeof(int64_t));
+	int *pos = calloc(table->size + 1, sizeof(int));
+	int *cpu = calloc(table->size + 1, sizeof(int));
+	int h, i, ok = 1;
+
+	for (h = 0; h < table->size; h++) // parametros em colunas, pelo handle
+	{
+		if (table->status[h] == PTAB_FREE)
+			continue;
+		if (table->sched_slot[h] != indexLottery) // parametros de outro escalonador, sem o formato da loteria
+		{
+			ok = 0;
+			break;
+		}
+		params = processGetSchedParams(table->proc[h]);
+		tickets[h] = params->num_tickets;
+		compensation[h] = params->compensation;
+		pos[h] = params->index_pos;
+		cpu[h] = params->cpu;
+	}
+
+	snapBeginSection(s, SNAP_SEC_LOTT);
+	snapWrite(s, &info, sizeof(info));
+	snapWrite(s, tickets, table->size * sizeof(int64_t));
+	snapWrite(s, compensation, table->size * sizeof(int64_t));
+	snapWrite(s, pos, table->size * sizeof(int));
+	snapWrite(s, cpu, table->size * sizeof(int));
+	for (i = 0; i < lottNumCpus; i++) // gerador e indice de cada fila
+	{
+		snapWrite(s, &lottCpus[i].rng, sizeof(Rng));
+		tidxSave(&lottCpus[i].index, s);
+	}
+	snapWrite(s, &lottBatchRng, sizeof(Rng));
+
+	free(tickets);
+	free(compensation);
+	free(pos);
+	free(cpu);
+	return ok;
+}
+
+/**
+ * @brief Funcao que restaura o estado gravado por lottSave, depois da tabela de processos
+ *
+ * @param s instantaneo aberto
+ * @return int 1 caso o estado seja restaurado e 0, caso contrario
+ */
+int lottLoad(Snapshot *s)
+{
+	ProcTable *table = processGetTable();
+	const LottSnapInfo *info;
+	const int64_t *tickets, *compensation;
+	const int *pos, *cpu;
+	const Rng *rng;
+	LotterySchedParams *params;
+	int64_t supply = 0, weight;
+	Process *p;
+	int h, i, k;
+
+	if (!snapSeek(s, SNAP_SEC_LOTT) || (info = snapRead(s, sizeof(LottSnapInfo))) == NULL)
+		return 0;
+	if (info->size != table->size || info->num_cpus < 1 || info->num_cpus > SCHED_MAX_CPUS)
+		return 0;
+	tickets = snapRead(s, info->size * sizeof(int64_t));
+	compensation = snapRead(s, info->size * sizeof(int64_t));
+	pos = snapRead(s, info->size * sizeof(int));
+	cpu = snapRead(s, info->size * sizeof(int));
+	if (s->error)
+		return 0;
+	for (h = 0; h < info->size; h++) // so processos prontos ocupam posicao nos indices
+	{
+		if (table->status[h] == PTAB_FREE)
+			continue;
+		if (table->sched_slot[h] != indexLottery || cpu[h] < 0 || cpu[h] >= info->num_cpus || pos[h] < -1 ||
+			(pos[h] >= 0) != (table->status[h] == PROC_READY) || tickets[h] < 0 || compensation[h] < 0 ||
+			__builtin_add_overflow(supply, tickets[h], &supply) || __builtin_add_overflow(supply, compensation[h], &supply))
+			return 0;
+	}
+	if (supply != info->supply)
+		return 0;
+
+	// filas novas, substituidas pelos indices gravados
+	if (lottSetNumCpus(1) < 0 || lottSetNumCpus(info->num_cpus) < 0)
+		return 0;
+	for (i = 0; i < info->num_cpus; i++)
+	{
+		if ((rng = snapRead(s, sizeof(Rng))) == NULL)
+			return 0;
+		lottCpus[i].rng = *rng;
+		if (!tidxLoad(&lottCpus[i].index, s, table->proc, table->size))
+			return 0;
+	}
+	if ((rng = snapRead(s, sizeof(Rng))) == NULL)
+		return 0;
+	lottBatchRng = *rng;
+
+	// cada posicao ocupada eh do processo pronto que a gravou, na sua fila e com o seu peso
+	for (i = 0; i < info->num_cpus; i++)
+		for (k = 0; k < lottCpus[i].index.size; k++)
+		{
+			if ((p = tidxItem(&lottCpus[i].index, k)) == NULL)
+				continue;
+			h = processGetHandle(p);
+			if (__builtin_add_overflow(tickets[h], compensation[h], &weight))
+				weight = INT64_MAX; // como em lottWeight
+			if (table->status[h] != PROC_READY || cpu[h] != i || pos[h] != k || tidxWeight(&lottCpus[i].index, k) != weight)
+				return 0;
+		}
+
+	for (h = 0; h < info->size; h++) // cada processo pronto volta a posicao gravada na sua fila (uma so)
+	{
+		if (table->status[h] == PTAB_FREE)
+			continue;
+		if (pos[h] >= 0 && (pos[h] >= lottCpus[cpu[h]].index.size || tidxItem(&lottCpus[cpu[h]].index, pos[h]) != table->proc[h]))
+			return 0;
+		params = lottAllocParams();
+		params->num_tickets = tickets[h];
+		params->compensation = compensation[h];
+		params->index_pos = pos[h];
+		params->cpu = cpu[h];
+		processSetSchedParams(table->proc[h], params);
+	}
+	lottTicketSupply = info->supply;
+	lottSeed = info->seed;
+	lottNextCpu = info->next_cpu % info->num_cpus;
+	return 1;
+}
+
+/**
+ * @brief Funcao que liga ou desliga a impressao de cada bilhete sorteado
+ *
+ * @param verbose 1 para imprimir e 0, caso contrario
+ */
+void lottSetVerbose(int verbose)
+{
+	lottVerbose = verbose;
+}
@@ -1,12 +1,16 @@
 #ifndef LOTTERY_H
 #define LOTTERY_H
 
+#include <stdint.h>
 #include "scheduler.h"
 
+#define LOTT_DEFAULT_SEED 1994 // semente usada ate lottSetSeed ser chamada
+
 typedef struct lottery_params {
-        int num_tickets; //numero de tickets
-        int num_minor_ticket; //numero de tickets antes da soma
-        int num_greater_ticket; //numero de tickets apos a soma
+        int64_t num_tickets; //numero de tickets
+        int index_pos; //posicao no indice de tickets (-1 se nao estiver pronto)
+        int cpu; //fila (CPU) a que o processo pertence
+        int64_t compensation; //tickets de compensacao (valem ate o processo voltar a executar)
 } LotterySchedParams;
 
 /**
@@ -40,6 +44,58 @@ void lottNotifyProcStatusChange(Process* p);
  */
 Process* lottSchedule(Process *plist);
 
+/**
+ * @brief Funcao que realiza o escalonamento por loteria na fila de uma CPU
+ *
+ * Com a fila vazia, a CPU rouba um processo de outra fila, escolhida com
+ * probabilidade proporcional aos tickets de cada fila.
+ *
+ * @param plist processo
+ * @param cpu numero da CPU
+ * @return Process* processo sorteado
+ */
+Process *lottScheduleCpu(Process *plist, int cpu);
+
+/**
+ * @brief Funcao que sorteia varios processos distintos de uma vez, sem reposicao, em O(M log n)
+ *
+ * @param plist processo
+ * @param winners saida com os processos sorteados
+ * @param m quantidade desejada
+ * @return int quantidade sorteada (menor que m se faltarem processos prontos)
+ */
+int lottScheduleMany(Process *plist, Process **winners, int m);
+
+/**
+ * @brief Funcao que define quantas filas (CPUs) o escalonador mantem
+ *
+ * Chamada por schedSetNumCpus (setNumCpusFn). Os processos prontos das filas
+ * removidas sao redistribuidos entre as filas que ficam.
+ *
+ * @param n quantidade de CPUs
+ * @return int quantidade definida e -1, caso seja invalida
+ */
+int lottSetNumCpus(int n);
+
+/**
+ * @brief Funcao que retorna quantos processos foram roubados de outras filas
+ *
+ * @return long numero de roubos
+ */
+long lottGetStealCount(void);
+
+/**
+ * @brief Funcao que concede tickets de compensacao a um processo que usou so parte do quantum
+ *
+ * Quem usa a fracao f do quantum tem seus tickets multiplicados por 1/f ate
+ * voltar a executar. A concessao e a expiracao atualizam apenas a posicao do
+ * processo no indice, em O(log n).
+ *
+ * @param p processo
+ * @param used fracao usada do quantum, entre 0 e SCHED_QUANTUM_UNITS
+ */
+void lottChargeQuantum(Process *p, int used);
+
 /**
  * @brief Funcao que libera os parametros de escalonamento de um processo
  * 
@@ -54,8 +110,101 @@ int lottReleaseParams(Process *p);
  * @param src processo origem
  * @param dst processo destino
  * @param tickets numero de tickets
- * @return int numero de tickets que foi transferido
+ * @return int64_t numero de tickets que foi transferido
+ */
+int64_t lottTransferTickets(Process *src, Process *dst, int64_t tickets);
+
+/**
+ * @brief Funcao que realiza a inflacao (ou deflacao, com delta negativo) dos tickets de um processo
+ *
+ * A operacao eh recusada se o processo ficar com tickets negativos ou se o total
+ * de tickets do escalonador ultrapassar o limite de 64 bits.
+ *
+ * @param p processo
+ * @param delta quantidade de tickets criados (ou destruidos)
+ * @return int64_t novo numero de tickets do processo e -1, caso a operacao seja recusada
+ */
+int64_t lottInflateTickets(Process *p, int64_t delta);
+
+/**
+ * @brief Funcao que retorna o total de tickets dos processos prontos, mantido por deltas
+ *
+ * @return int64_t total de tickets
+ */
+int64_t lottGetTotalTickets(void);
+
+/**
+ * @brief Funcao que retorna quantas vezes o indice de tickets foi reconstruido por completo
+ *
+ * @return long numero de reconstrucoes
+ */
+long lottGetRebuildCount(void);
+
+/**
+ * @brief Funcao que inicializa o pool de parametros de escalonamento
+ *
+ * @param prealloc quantidade de parametros pre-alocados
+ * @param flags opcoes do pool (POOL_HUGEPAGES ou 0)
+ */
+void lottInitParamsPool(long prealloc, int flags);
+
+/**
+ * @brief Funcao que aloca os parametros de escalonamento de um processo
+ *
+ * Os parametros sao devolvidos ao pool por lottReleaseParams.
+ *
+ * @return LotterySchedParams* parametros
+ */
+LotterySchedParams *lottAllocParams(void);
+
+/**
+ * @brief Funcao que devolve ao pool os parametros de escalonamento de um processo
+ *
+ * @param params parametros
+ */
+void lottFreeParams(LotterySchedParams *params);
+
+/**
+ * @brief Funcao que preenche as estatisticas do pool de parametros
+ *
+ * @param stats estatisticas
+ */
+void lottGetParamsPoolStats(PoolStats *stats);
+
+/**
+ * @brief Funcao que reinicia o gerador de numeros aleatorios do escalonador
+ *
+ * A mesma semente e a mesma sequencia de eventos reproduzem os mesmos sorteios.
+ *
+ * @param seed semente
+ */
+void lottSetSeed(uint64_t seed);
+
+/**
+ * @brief Funcao que grava no instantaneo os parametros dos processos, as filas, os indices e os geradores
+ *
+ * @param s instantaneo em gravacao
+ * @return int 1 caso a secao seja gravada e 0, caso algum processo seja de outro escalonador
+ */
+int lottSave(Snapshot *s);
+
+/**
+ * @brief Funcao que restaura o estado gravado por lottSave, depois da tabela de processos
+ *
+ * Os indices de tickets sao copiados com a arvore pronta, sem reinserir os
+ * processos. Em caso de falha o estado do escalonador fica incompleto e a
+ * simulacao nao deve continuar.
+ *
+ * @param s instantaneo aberto
+ * @return int 1 caso o estado seja restaurado e 0, caso contrario
+ */
+int lottLoad(Snapshot *s);
+
+/**
+ * @brief Funcao que liga ou desliga a impressao de cada bilhete sorteado
+ *
+ * @param verbose 1 para imprimir e 0, caso contrario
  */
-int lottTransferTickets(Process *src, Process *dst, int tickets);
+void lottSetVerbose(int verbose);
 
 #endif
@@ -1,17 +1,128 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <inttypes.h>
+#include <math.h>
 #include "process.h"
+#include "proctable.h"
 #include "scheduler.h"
 #include "lottery.h"
+#include "alias.h"
+#include "stride.h"
+#include "rng.h"
+#include "trace.h"
+#include "currency.h"
+#include "timewheel.h"
+#include "workload.h"
+#include "snapshot.h"
 
-// automatizar os processos
+// valores padrao da simulacao
 #define SCHED_ITERATIONS 1				  // iteracoes
 #define PROCESS_CREATION_PROBABILITY 0.3  // probabilidade de criacao
 #define PROCESS_DESTROY_PROBABILITY 0.05  // probabilidade de remocao
 #define PROCESS_BLOCK_PROBABILITY 0.6	  // probabilidade de bloqueio
 #define PROCESS_UNBLOCK_PROBABILITY 0.4	  // probabilidade de desbloqueio
 #define PROCESS_TCKTRANSF_PROBABILITY 0.1 // probabilidade de transferencia de tickets
+#define SIM_MAX_CURRENCIES 64			  // moedas de tickets da simulacao
+#define SIM_CURRENCY_FUNDING 10000		  // tickets base de cada moeda
+#define SIM_MAX_EVENT_DELAY (1LL << 40)	  // passos maximos ate um evento (probabilidades muito pequenas)
+#define SIM_SAMPLE_ATTEMPTS 64			  // posicoes da tabela sorteadas antes de percorrer a lista de prontos
+
+// eventos da simulacao por eventos
+#define SIM_EVENT_WAKE 0  // desbloqueio de um processo aguardando
+#define SIM_EVENT_DEATH 1 // remocao de um processo pronto
+
+// configuracao da simulacao
+typedef struct sim_config
+{
+	int iterations;		  // quanta por passo
+	double create_prob;	  // probabilidade de criacao
+	double destroy_prob;  // probabilidade de remocao
+	double block_prob;	  // probabilidade de bloqueio
+	double unblock_prob;  // probabilidade de desbloqueio
+	double transfer_prob; // probabilidade de transferencia de tickets
+	long long quanta;	  // quanta do modo sem interacao (0 para o modo interativo)
+	int cpus;			  // quantidade de CPUs
+	int verbose;		  // 1 para imprimir cada acao e sorteio
+	uint64_t seed;		  // semente
+	const char *trace;	  // arquivo de rastreamento (NULL para desligado)
+	const char *record;	  // arquivo onde a carga eh gravada (NULL para desligado)
+	const char *replay;	  // rastro de carga reproduzido no lugar das acoes aleatorias (NULL para desligado)
+	const char *save;	  // arquivo onde o estado eh salvo ao final (NULL para desligado)
+	const char *restore;  // instantaneo de onde o estado eh restaurado (NULL para criar os processos)
+	int latency;		  // 1 para medir a latencia de cada decisao
+	char engine[8];		  // escalonador: lott, alia, strd ou misto
+	int currencies;		  // moedas de tickets (0 para tickets base)
+	int compensation;	  // 1 para bloquear no meio do quantum, com tickets de compensacao
+	int events;			  // 1 para a simulacao por eventos (roda de tempo)
+	int processes;		  // processos criados antes do primeiro passo
+	int batch;			  // 1 para sortear os processos de todas as CPUs de uma vez
+} SimConfig;
+
+SimConfig simConfig = {SCHED_ITERATIONS, PROCESS_CREATION_PROBABILITY, PROCESS_DESTROY_PROBABILITY,
+					   PROCESS_BLOCK_PROBABILITY, PROCESS_UNBLOCK_PROBABILITY, PROCESS_TCKTRANSF_PROBABILITY,
+					   0, 1, 1, 0, NULL, NULL, NULL, NULL, NULL, 1, "lott", 0, 0, 0, 0, 0};
+
+// impressao apenas no modo detalhado, fora do caminho critico do modo sem interacao
+#define SIM_PRINTF(...) do { if (simConfig.verbose) printf(__VA_ARGS__); } while (0)
+
+Rng simRng; // gerador das acoes aleatorias da simulacao
+int simNumSlots = 1; // escalonadores registrados (2 no modo misto)
+Currency *simCurrencies[SIM_MAX_CURRENCIES]; // moedas dos grupos de processos
+TimeWheel simWheel; // proximo evento de cada processo (simulacao por eventos)
+long long simStep = 0; // passos de acoes realizados
+
+// cabecalho da secao da simulacao no instantaneo
+typedef struct sim_snap_info
+{
+	uint64_t seed;		// semente da execucao que gerou o estado
+	int64_t step;		// passos de acoes realizados
+	Rng rng;			// gerador das acoes aleatorias
+	int32_t cpus;		// CPUs
+	int32_t events;		// simulacao por eventos (grava a roda de tempo)
+	int32_t processes;	// processos vivos
+	int32_t reserved;
+} SimSnapInfo;
+
+/**
+ * @brief Funcao que sorteia em quantos passos acontece um evento de probabilidade fixa por passo
+ *
+ * Amostra a distribuicao geometrica por inversao, com um unico numero aleatorio,
+ * em vez de sortear o evento a cada passo.
+ *
+ * @param prob probabilidade do evento em cada passo
+ * @return long long passos ate o evento (pelo menos 1) ou -1, caso nunca aconteca
+ */
+long long sampleSteps(double prob)
+{
+	double u = 1.0 - rngDouble(&simRng); // em (0, 1]
+	double steps;
+
+	if (prob <= 0)
+		return -1;
+	if (prob >= 1)
+		return 1;
+	steps = floor(log(u) / log1p(-prob)) + 1;
+	return steps > SIM_MAX_EVENT_DELAY ? SIM_MAX_EVENT_DELAY : (long long)steps;
+}
+
+/**
+ * @brief Funcao que agenda o proximo evento de um processo na roda de tempo
+ *
+ * @param p processo
+ * @param kind tipo do evento (SIM_EVENT_WAKE ou SIM_EVENT_DEATH)
+ * @param prob probabilidade do evento em cada passo
+ */
+void scheduleEvent(Process *p, int kind, double prob)
+{
+	long long steps = sampleSteps(prob);
+
+	if (steps < 0) // evento impossivel: nada fica pendente
+		twhlCancel(&simWheel, processGetHandle(p));
+	else
+		twhlSchedule(&simWheel, processGetHandle(p), simStep + steps, kind);
+}
 
 /**
  * @brief Funcao para inicializar parametros
@@ -21,7 +132,7 @@
 void dumpSchedParams(Process *p)
 {
 	LotterySchedParams *lsp = processGetSchedParams(p);
-	printf("Tickets: %d", lsp->num_tickets);
+	printf("Tickets: %" PRId64, lsp->num_tickets);
 }
 
 /**
@@ -32,18 +143,23 @@ void dumpSchedParams(Process *p)
  * @param num_tickets numero de tickets do processo
  * @return Process* processo criado
  */
-Process *createProcess(Process *plist, int ppid, int num_tickets)
+Process *createProcess(Process *plist, int ppid, int64_t num_tickets)
 {
 	LotterySchedParams *lsp;
-	printf("Criando processo... ");
+	SIM_PRINTF("Criando processo... ");
 	// inicializa os parametros
 	plist = processCreate(plist);
-	lsp = malloc(sizeof(LotterySchedParams));
+	lsp = lottAllocParams();
 	lsp->num_tickets = num_tickets;
-	lottInitSchedParams(plist, lsp);
+	schedGetSchedInfo(processGetPid(plist) % simNumSlots)->initParamsFn(plist, lsp); // escalonador escolhido (alternado no modo misto)
 	processSetStatus(plist, PROC_READY);
 	processSetParentPid(plist, ppid);
-	printf(" Criado PID %d!\n", processGetPid(plist));
+	if (simConfig.events && processGetPid(plist) != 1) // o processo inicial nunca eh removido
+		scheduleEvent(plist, SIM_EVENT_DEATH, simConfig.destroy_prob);
+	if (simConfig.currencies > 0) // tickets na moeda do grupo do processo
+		currIssue(simCurrencies[processGetPid(plist) % simConfig.currencies], plist, num_tickets);
+	WKLD_RECORD(WKLD_CREATE, processGetPid(plist), 0, num_tickets);
+	SIM_PRINTF(" Criado PID %d!\n", processGetPid(plist));
 	return plist; // retorna o processo
 }
 
@@ -56,10 +172,17 @@ Process *createProcess(Process *plist, int ppid, int num_tickets)
  */
 Process *destroyProcess(Process *plist, int pid)
 {
+	Process *p = processGetByPid(plist, pid);
+
 	// processo de destruicao
-	printf("Destruindo processo... ");
+	SIM_PRINTF("Destruindo processo... ");
+	if (simConfig.currencies > 0)
+		currRelease(p); // devolve os tickets da moeda
+	if (simConfig.events) // o handle sera reaproveitado
+		twhlCancel(&simWheel, processGetHandle(p));
 	plist = processDestroy(plist, pid);
-	printf(" Destruido PID %d!\n", pid);
+	WKLD_RECORD(WKLD_DESTROY, pid, 0, 0);
+	SIM_PRINTF(" Destruido PID %d!\n", pid);
 	return plist;
 }
 
@@ -71,17 +194,7 @@ Process *destroyProcess(Process *plist, int pid)
  */
 int countReady(Process *plist)
 {
-	Process *p, *next;
-	int count = 0;
-
-	// percorre a lista
-	for (p = plist; p != NULL; p = next)
-	{
-		next = processGetNext(p);
-		if (processGetStatus(p) == PROC_READY)
-			count++;
-	}
-	return count;
+	return processCountByStatus(PROC_READY); // mantido pela lista de prontos
 }
 
 /**
@@ -93,21 +206,92 @@ int countReady(Process *plist)
  */
 Process *getNthReady(Process *plist, int n)
 {
-	Process *p = NULL, *next;
+	Process *p;
 	int count = 0;
 
-	// percorre a lista
-	for (p = plist; p != NULL; p = next)
+	// percorre apenas a lista de prontos
+	for (p = processFirstByStatus(PROC_READY); p != NULL; p = processNextByStatus(p))
 	{
-		next = processGetNext(p);
-		if (processGetStatus(p) == PROC_READY) // verifica os processos prontos
-			count++;						   // incrementa
-		if (count == n)						   // verifica se eh igual ao numero aleatorio
-			return p;						   // retorna o processo
+		count++;		// incrementa
+		if (count == n) // verifica se eh igual ao numero aleatorio
+			return p;	// retorna o processo
 	}
 	return NULL;
 }
 
+/**
+ * @brief Funcao para obter um processo pronto sorteando posicoes da tabela de processos
+ *
+ * Com muitos processos prontos evita percorrer a lista; com poucos, a lista eh
+ * percorrida como em getNthReady.
+ *
+ * @param plist processo
+ * @param n numero aleatorio (usado se o sorteio de posicoes falhar)
+ * @return Process* processo
+ */
+Process *sampleReady(Process *plist, int n)
+{
+	ProcTable *table = processGetTable();
+	int attempt, handle;
+
+	for (attempt = 0; attempt < SIM_SAMPLE_ATTEMPTS; attempt++)
+	{
+		handle = (int)rngBounded(&simRng, table->size);
+		if (table->status[handle] == PROC_READY)
+			return table->proc[handle];
+	}
+	return getNthReady(plist, n);
+}
+
+/**
+ * @brief Funcao que bloqueia um processo em execucao, podendo transferir seus tickets para um processo pronto
+ *
+ * @param plist processo
+ * @param p processo em execucao
+ */
+void blockProcess(Process *plist, Process *p)
+{
+	Process *dst;				   // destino da transferencia
+	int pid = processGetPid(p), n; // auxiliadores
+	int64_t transfer, transferred; // tickets pedidos e transferidos
+	int ready;					   // auxiliar processo pronto
+	int used = 0;				   // fracao usada do quantum (0 = quantum inteiro)
+	double r;					   // numero aleatorio
+
+	if (simConfig.compensation) // bloqueia (E/S) depois de usar so parte do quantum
+	{
+		used = (int)rngBounded(&simRng, SCHED_QUANTUM_UNITS) + 1;
+		schedYield(p, used);
+	}
+	processSetStatus(p, PROC_WAITING);	   // altera o status para aguardando
+	WKLD_RECORD(WKLD_BLOCK, pid, 0, used);
+	r = rngDouble(&simRng);		   // sorteio de um numero aleatorio
+	if (r < simConfig.transfer_prob) // se o numero aleatorio eh menor que a probabilidade de transferencia do processo
+	{
+		ready = countReady(plist) - 1; // quantidade de processos prontos
+		if (ready > 0)				   // se a quantidade de processos prontos for maior que zero
+		{
+			n = (int)rngBounded(&simRng, ready) + 1;				 // sorteia um numero aleatorio entre 1 e a quantidade de processos prontos
+			transfer = ((int64_t)rngBounded(&simRng, 100) + 1) * 100; // sorteio um numero aleatorio para a transferencia
+			dst = simConfig.events ? sampleReady(plist, n) : getNthReady(plist, n); // pega um processo para ser transferido
+			if (simConfig.currencies > 0) // com moedas, so entre processos do mesmo grupo
+			{
+				transferred = currTransfer(p, dst, transfer);
+				if (transferred < 0) // grupos diferentes
+					transferred = 0;
+			}
+			else
+				transferred = lottTransferTickets(p, dst,
+												  transfer); // realiza a transferencia
+			WKLD_RECORD(WKLD_TRANSFER, pid, processGetPid(dst), transferred);
+			SIM_PRINTF("Transferidos %" PRId64 " tickets do processo %d para processo %d, de %" PRId64 " solicitados\n",
+				   transferred, pid,
+				   processGetPid(dst), transfer);
+		}
+	}
+	SIM_PRINTF("Bloqueado processo %d\n", pid); // boqueia o processo
+}
+
 /**
  * @brief Funcao para realizar acoes aleatorias
  *
@@ -116,14 +300,13 @@ Process *getNthReady(Process *plist, int n)
  */
 Process *randomActions(Process *plist)
 {
-	Process *p, *next, *dst;			  // auxiliadores
-	int pid, n, transfer, transferred;	  // auxiliadores
-	int ready;							  // auxiliar processo pronto
-	double r = rand() / (double)RAND_MAX; // sorteio de um numero aleatorio
-	printf("===Acoes Aleatorias===\n");
+	Process *p, *next;			   // auxiliadores
+	int pid;					   // auxiliadores
+	double r = rngDouble(&simRng); // sorteio de um numero aleatorio
+	SIM_PRINTF("===Acoes Aleatorias===\n");
 	// se o numero aleatorio eh menor que a probabilidade de criacao do processo, cria o novo processo
-	if (r < PROCESS_CREATION_PROBABILITY)
-		plist = createProcess(plist, 1, (rand() % 100 + 1) * 100);
+	if (r < simConfig.create_prob)
+		plist = createProcess(plist, 1, ((int64_t)rngBounded(&simRng, 100) + 1) * 100);
 
 	// percorre a lista de processos
 	for (p = plist; p != NULL; p = next)
@@ -132,95 +315,717 @@ Process *randomActions(Process *plist)
 		pid = processGetPid(p);	  // identificador do processo
 		if (pid == 1)
 			continue;
-		r = rand() / (double)RAND_MAX; // sorteio de um numero aleatorio
+		r = rngDouble(&simRng); // sorteio de um numero aleatorio
 
 		// se o processo esta pronto e o numero aleatorio eh menor que a probabilidade de destruicao do processo
 		if (processGetStatus(p) == PROC_READY &&
-			r < PROCESS_DESTROY_PROBABILITY)
+			r < simConfig.destroy_prob)
 		{
 			plist = destroyProcess(plist, processGetPid(p)); // destroi o processo
 			continue;
 		}
-		r = rand() / (double)RAND_MAX; // sorteio de um numero aleatorio
+		r = rngDouble(&simRng); // sorteio de um numero aleatorio
 
 		// se o processo esta executando e o numero aleatorio eh menor que a probabilidade de bloqueio do processo
 		if (processGetStatus(p) == PROC_RUNNING &&
-			r < PROCESS_BLOCK_PROBABILITY)
+			r < simConfig.block_prob)
 		{
-			processSetStatus(p, PROC_WAITING);	   // altera o status para aguardando
-			r = rand() / (double)RAND_MAX;		   // sorteio de um numero aleatorio
-			if (r < PROCESS_TCKTRANSF_PROBABILITY) // se o numero aleatorio eh menor que a probabilidade de transferencia do processo
-			{
-				ready = countReady(plist) - 1; // quantidade de processos prontos
-				if (ready > 0)				   // se a quantidade de processos prontos for maior que zero
-				{
-					n = rand() % ready + 1;				 // sorteia um numero aleatorio entre 1 e a quantidade de processos prontos
-					transfer = (rand() % 100 + 1) * 100; // sorteio um numero aleatorio para a transferencia
-					dst = getNthReady(plist, n);		 // pega um processo para ser transferido
-					transferred = lottTransferTickets(p, dst,
-													  transfer); // realiza a transferencia
-					printf("Transferidos %d tickets do processo %d para processo %d, de %d solicitados\n",
-						   transferred, pid,
-						   processGetPid(dst), transfer);
-				}
-			}
-			printf("Bloqueado processo %d\n", pid); // boqueia o processo
+			blockProcess(plist, p);
 		}
 
 		// se o processo esta aguardando e o numero aleatorio eh menor que sua probabilidade de desbloqueio
-		else if (processGetStatus(p) == PROC_WAITING && r < PROCESS_UNBLOCK_PROBABILITY)
+		else if (processGetStatus(p) == PROC_WAITING && r < simConfig.unblock_prob)
 		{
 			processSetStatus(p, PROC_READY); // desbloqueia o processo e coloca como pronto
-			printf("Desbloqueado processo %d\n", pid);
+			WKLD_RECORD(WKLD_UNBLOCK, pid, 0, 0);
+			SIM_PRINTF("Desbloqueado processo %d\n", pid);
 		}
 	}
 
-	printf("======================\n");
+	SIM_PRINTF("======================\n");
 	return plist;
 }
 
-int main(void)
+/**
+ * @brief Funcao para realizar as acoes do passo pela roda de tempo, sem percorrer os processos
+ *
+ * Cada processo tem um unico evento pendente, sorteado uma vez: o desbloqueio,
+ * se estiver aguardando, ou a remocao, caso contrario. O bloqueio so depende
+ * dos processos em execucao, uma tentativa por CPU. O custo do passo eh
+ * proporcional aos eventos vencidos e as CPUs, nao a quantidade de processos.
+ *
+ * @param plist processo
+ * @return Process* processo modificado
+ */
+Process *eventActions(Process *plist)
+{
+	ProcTable *table = processGetTable();
+	Process *p;						// auxiliador
+	int cpu, handle, kind;			// auxiliadores
+	double r = rngDouble(&simRng); // sorteio de um numero aleatorio
+	SIM_PRINTF("===Acoes Aleatorias===\n");
+	simStep++;
+	if (r < simConfig.create_prob)
+		plist = createProcess(plist, 1, ((int64_t)rngBounded(&simRng, 100) + 1) * 100);
+
+	// processos em execucao podem bloquear; o desbloqueio fica agendado
+	for (cpu = 0; cpu < simConfig.cpus; cpu++)
+	{
+		p = schedGetRunning(cpu);
+		if (p == NULL || processGetPid(p) == 1 || rngDouble(&simRng) >= simConfig.block_prob)
+			continue;
+		blockProcess(plist, p);
+		scheduleEvent(p, SIM_EVENT_WAKE, simConfig.unblock_prob);
+	}
+
+	// somente os eventos vencidos neste passo
+	while ((handle = twhlPop(&simWheel, simStep, &kind)) >= 0)
+	{
+		p = table->proc[handle];
+		if (kind == SIM_EVENT_WAKE)
+		{
+			processSetStatus(p, PROC_READY); // desbloqueia o processo e coloca como pronto
+			WKLD_RECORD(WKLD_UNBLOCK, processGetPid(p), 0, 0);
+			SIM_PRINTF("Desbloqueado processo %d\n", processGetPid(p));
+			scheduleEvent(p, SIM_EVENT_DEATH, simConfig.destroy_prob);
+		}
+		else if (processGetStatus(p) == PROC_READY)
+			plist = destroyProcess(plist, processGetPid(p)); // destroi o processo
+		else // em execucao: so processos prontos sao removidos, sorteia de novo
+			scheduleEvent(p, SIM_EVENT_DEATH, simConfig.destroy_prob);
+	}
+
+	SIM_PRINTF("======================\n");
+	return plist;
+}
+
+/**
+ * @brief Funcao que realiza as acoes de um passo no modo configurado
+ *
+ * @param plist processo
+ * @return Process* processo modificado
+ */
+Process *simActions(Process *plist)
+{
+	return simConfig.events ? eventActions(plist) : randomActions(plist);
+}
+
+/**
+ * @brief Funcao que altera um parametro da configuracao pelo nome
+ *
+ * @param cfg configuracao
+ * @param key nome do parametro
+ * @param value valor em texto
+ * @return int 1 caso o parametro exista e 0, caso contrario
+ */
+int setConfigValue(SimConfig *cfg, const char *key, const char *value)
+{
+	if (!strcmp(key, "iteracoes"))
+		cfg->iterations = atoi(value);
+	else if (!strcmp(key, "criacao"))
+		cfg->create_prob = atof(value);
+	else if (!strcmp(key, "remocao"))
+		cfg->destroy_prob = atof(value);
+	else if (!strcmp(key, "bloqueio"))
+		cfg->block_prob = atof(value);
+	else if (!strcmp(key, "desbloqueio"))
+		cfg->unblock_prob = atof(value);
+	else if (!strcmp(key, "transferencia"))
+		cfg->transfer_prob = atof(value);
+	else if (!strcmp(key, "quanta"))
+		cfg->quanta = atoll(value);
+	else if (!strcmp(key, "cpus"))
+		cfg->cpus = atoi(value);
+	else if (!strcmp(key, "semente"))
+		cfg->seed = strtoull(value, NULL, 10);
+	else if (!strcmp(key, "latencia"))
+		cfg->latency = atoi(value);
+	else if (!strcmp(key, "escalonador"))
+		snprintf(cfg->engine, sizeof(cfg->engine), "%s", value);
+	else if (!strcmp(key, "moedas"))
+		cfg->currencies = atoi(value);
+	else if (!strcmp(key, "compensacao"))
+		cfg->compensation = atoi(value);
+	else if (!strcmp(key, "eventos"))
+		cfg->events = atoi(value);
+	else if (!strcmp(key, "processos"))
+		cfg->processes = atoi(value);
+	else if (!strcmp(key, "lote"))
+		cfg->batch = atoi(value);
+	else
+		return 0;
+	return 1;
+}
+
+/**
+ * @brief Funcao que le um arquivo de configuracao com linhas "chave = valor" (# inicia comentario)
+ *
+ * @param cfg configuracao
+ * @param path caminho do arquivo
+ * @return int 1 caso o arquivo seja lido e 0, caso contrario
+ */
+int loadConfigFile(SimConfig *cfg, const char *path)
+{
+	char line[256], key[64], value[128];
+	FILE *f = fopen(path, "r");
+	int ok = 1;
+
+	if (f == NULL)
+	{
+		fprintf(stderr, "Nao foi possivel abrir %s\n", path);
+		return 0;
+	}
+	while (fgets(line, sizeof(line), f))
+	{
+		if (line[strspn(line, " \t")] == '#' || sscanf(line, " %63[^= \t] = %127s", key, value) != 2)
+			continue; // comentario ou linha vazia
+		if (!setConfigValue(cfg, key, value))
+		{
+			fprintf(stderr, "Parametro desconhecido em %s: %s\n", path, key);
+			ok = 0;
+		}
+	}
+	fclose(f);
+	return ok;
+}
+
+/**
+ * @brief Funcao que le a configuracao da linha de comando
+ *
+ * Aceita a semente como primeiro argumento (uso antigo), --config arquivo,
+ * --rastro arquivo, --gravar arquivo, --reproduzir arquivo, --salvar arquivo,
+ * --restaurar arquivo e --chave valor para cada parametro de setConfigValue. Com --quanta a
+ * simulacao roda sem interacao e sem impressao por sorteio.
+ *
+ * @param cfg configuracao
+ * @param argc quantidade de argumentos
+ * @param argv argumentos
+ * @return int 1 caso a linha de comando seja valida e 0, caso contrario
+ */
+int parseArgs(SimConfig *cfg, int argc, char *argv[])
+{
+	int i;
+
+	cfg->seed = (uint64_t)time(NULL); // semente padrao
+	for (i = 1; i < argc; i++)
+	{
+		if (strncmp(argv[i], "--", 2)) // semente sem nome
+			cfg->seed = strtoull(argv[i], NULL, 10);
+		else if (!strcmp(argv[i], "--detalhado"))
+			cfg->verbose = 2; // forca a impressao tambem no modo sem interacao
+		else if (i + 1 >= argc)
+		{
+			fprintf(stderr, "Falta o valor de %s\n", argv[i]);
+			return 0;
+		}
+		else if (!strcmp(argv[i], "--config"))
+		{
+			if (!loadConfigFile(cfg, argv[++i]))
+				return 0;
+		}
+		else if (!strcmp(argv[i], "--rastro"))
+			cfg->trace = argv[++i];
+		else if (!strcmp(argv[i], "--gravar"))
+			cfg->record = argv[++i];
+		else if (!strcmp(argv[i], "--reproduzir"))
+			cfg->replay = argv[++i];
+		else if (!strcmp(argv[i], "--salvar"))
+			cfg->save = argv[++i];
+		else if (!strcmp(argv[i], "--restaurar"))
+			cfg->restore = argv[++i];
+		else if (!setConfigValue(cfg, argv[i] + 2, argv[i + 1]))
+		{
+			fprintf(stderr, "Parametro desconhecido: %s\n", argv[i]);
+			return 0;
+		}
+		else
+			i++;
+	}
+
+	if (cfg->iterations < 1 || cfg->cpus < 1 || cfg->cpus > SCHED_MAX_CPUS || cfg->quanta < 0 ||
+		cfg->currencies < 0 || cfg->currencies > SIM_MAX_CURRENCIES || cfg->processes < 0 ||
+		(strcmp(cfg->engine, "lott") && strcmp(cfg->engine, "alia") && strcmp(cfg->engine, "strd") &&
+		 strcmp(cfg->engine, "misto")))
+	{
+		fprintf(stderr, "Configuracao invalida\n");
+		return 0;
+	}
+	if ((cfg->save != NULL || cfg->restore != NULL) && (strcmp(cfg->engine, "lott") || cfg->currencies > 0))
+	{
+		fprintf(stderr, "Instantaneos so com o escalonador lott e sem moedas\n");
+		return 0;
+	}
+	if (cfg->restore != NULL && (cfg->replay != NULL || cfg->record != NULL)) // a carga comeca do zero
+	{
+		fprintf(stderr, "--restaurar nao pode ser usado com --reproduzir nem --gravar\n");
+		return 0;
+	}
+	if (cfg->quanta > 0 && cfg->verbose < 2) // modo sem interacao fica silencioso
+		cfg->verbose = 0;
+	return 1;
+}
+
+/**
+ * @brief Funcao que escalona todas as CPUs por um quantum
+ *
+ * No modo em lote os processos de todas as CPUs sao sorteados de uma vez,
+ * sem reposicao; caso contrario cada CPU decide na sua fila.
+ *
+ * @param plist processo
+ */
+void scheduleQuantum(Process *plist)
+{
+	Process *out[SCHED_MAX_CPUS];
+	int cpu;
+	if (simConfig.batch)
+		schedScheduleMany(plist, out, simConfig.cpus);
+	else
+		for (cpu = 0; cpu < simConfig.cpus; cpu++)
+			schedScheduleCpu(plist, cpu);
+	WKLD_RECORD(WKLD_QUANTUM, 0, 0, 1);
+}
+
+/**
+ * @brief Funcao que imprime os contadores de um escalonador
+ *
+ * @param slot slot do escalonador
+ */
+void printStats(int slot)
+{
+	SchedStats stats;
+
+	if (schedGetStats(slot, &stats) < 0)
+		return;
+	if (simNumSlots > 1) // identifica o escalonador no modo misto
+		printf("[%.4s] ", schedGetSchedInfo(slot)->name);
+	printf("Decisoes: %ld; Sem vencedor: %ld; Reconstrucoes: %ld; Nos por decisao: %.1f; Transferencias: %ld\n",
+		   stats.decisions, stats.failed_draws, stats.rebuilds,
+		   stats.decisions ? (double)stats.scanned / stats.decisions : 0.0, stats.transfers);
+	if (stats.yields > 0) // quanta devolvidos antes do fim
+		printf("Quanta devolvidos: %ld; Compensacoes: %ld\n", stats.yields, stats.compensations);
+	if (stats.latency_sum == 0) // medicao desligada
+		return;
+	printf("Latencia (ns): media %.0f; p50 %lld; p99 %lld; p999 %lld; max %lld\n",
+		   stats.decisions ? (double)stats.latency_sum / stats.decisions : 0.0, schedStatsPercentile(&stats, 0.5),
+		   schedStatsPercentile(&stats, 0.99), schedStatsPercentile(&stats, 0.999), stats.latency_max);
+}
+
+/**
+ * @brief Funcao que imprime a ocupacao dos pools de processos e de parametros da loteria
+ *
+ */
+void printPoolStats(void)
+{
+	PoolStats procs, params;
+
+	processGetPoolStats(&procs);
+	lottGetParamsPoolStats(&params);
+	printf("Pools: processos %ld em uso (maximo %ld); parametros %ld em uso (maximo %ld)\n",
+		   procs.live, procs.high_water, params.live, params.high_water);
+}
+
+/**
+ * @brief Funcao que roda a simulacao sem interacao e mede a vazao do escalonador
+ *
+ * Cada passo realiza as acoes aleatorias e depois escalona as CPUs por
+ * simConfig.iterations quanta, ate completar simConfig.quanta.
+ *
+ * @param plist processo
+ * @return Process* processo do inicio
+ */
+Process *runHeadless(Process *plist)
+{
+	struct timespec start, end;
+	long long q = 0;
+	double seconds;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (q < simConfig.quanta)
+	{
+		plist = simActions(plist);
+		for (i = 0; i < simConfig.iterations && q < simConfig.quanta; i++, q++)
+			scheduleQuantum(plist);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("Quanta: %lld; CPUs: %d; Decisoes: %lld\n", q, simConfig.cpus, q * simConfig.cpus);
+	printf("Tempo: %.3f s; Quanta/s: %.0f; Decisoes/s: %.0f\n", seconds,
+		   seconds > 0 ? q / seconds : 0.0, seconds > 0 ? q * simConfig.cpus / seconds : 0.0);
+	printf("Processos: %d prontos, %d executando, %d aguardando\n", processCountByStatus(PROC_READY),
+		   processCountByStatus(PROC_RUNNING), processCountByStatus(PROC_WAITING));
+	printf("Tickets prontos: %" PRId64 "; Roubos: %ld\n", lottGetTotalTickets(), lottGetStealCount());
+	printPoolStats();
+	for (i = 0; i < simNumSlots; i++)
+		printStats(i);
+	if (simConfig.events)
+		printf("Eventos pendentes: %d; Redistribuidos na roda: %ld\n", twhlCount(&simWheel),
+			   twhlGetCascaded(&simWheel));
+	if (simConfig.trace != NULL)
+		printf("Rastro: %s; Eventos descartados: %ld\n", simConfig.trace, traceGetDropped());
+	return plist;
+}
+
+/**
+ * @brief Funcao que reproduz um rastro de carga com o escalonador configurado e mede a vazao
+ *
+ * Os eventos sao decodificados direto do arquivo mapeado e os PIDs gravados sao
+ * traduzidos por um mapa alocado uma unica vez, pelo maior PID do cabecalho (ou
+ * dos eventos, quando a gravacao foi interrompida antes de completa-lo).
+ * Com outro escalonador um processo gravado como em execucao pode estar pronto
+ * no bloqueio: ele passa por execucao e bloqueia, mantendo a forma da carga.
+ *
+ * @param plist processo
+ * @param t rastro de carga
+ * @return Process* processo do inicio
+ */
+Process *runReplay(Process *plist, WorkloadTrace *t)
+{
+	Process **map = calloc((size_t)t->header.max_pid + 1, sizeof(Process *)); // processo de cada PID gravado
+	Process *p;
+	WorkloadEvent e;
+	struct timespec start, end;
+	long long events = 0, q = 0, skipped = 0, k;
+	double seconds, decode;
+	int status;
+
+	// so a decodificacao, separando o custo do formato do custo do escalonador
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while ((status = wkldNext(t, &e)) > 0)
+		events++;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	decode = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	if (status < 0 || map == NULL)
+	{
+		fprintf(stderr, "Rastro de carga corrompido apos %lld eventos\n", events);
+		free(map);
+		return plist;
+	}
+
+	if (t->unfinished) // gravacao interrompida: reproduz o que foi gravado
+		fprintf(stderr, "Rastro de carga incompleto: cabecalho nao completado; %lld eventos gravados\n", events);
+	else if ((uint64_t)events != t->header.events) // arquivo cortado depois da gravacao
+		fprintf(stderr, "Rastro de carga incompleto: %lld de %" PRIu64 " eventos\n", events, t->header.events);
+
+	wkldRewind(t);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (wkldNext(t, &e) > 0)
+	{
+		p = map[e.pid];
+		switch (e.type)
+		{
+		case WKLD_CREATE:
+			plist = createProcess(plist, 1, e.value);
+			map[e.pid] = plist;
+			break;
+		case WKLD_DESTROY:
+			if (p != NULL)
+				plist = destroyProcess(plist, processGetPid(p));
+			else
+				skipped++;
+			map[e.pid] = NULL;
+			break;
+		case WKLD_BLOCK:
+			if (p != NULL && processGetStatus(p) == PROC_READY) // nao estava executando neste escalonador
+				processSetStatus(p, PROC_RUNNING);
+			if (p == NULL || processGetStatus(p) != PROC_RUNNING)
+			{
+				skipped++;
+				break;
+			}
+			if (e.value > 0)
+				schedYield(p, (int)e.value);
+			processSetStatus(p, PROC_WAITING);
+			break;
+		case WKLD_UNBLOCK:
+			if (p == NULL || processGetStatus(p) != PROC_WAITING || processSetStatus(p, PROC_READY) < 0)
+				skipped++;
+			break;
+		case WKLD_TRANSFER:
+			if (p != NULL && map[e.dst] != NULL)
+				lottTransferTickets(p, map[e.dst], e.value);
+			else
+				skipped++;
+			break;
+		case WKLD_QUANTUM:
+			for (k = 0; k < e.value; k++)
+				scheduleQuantum(plist);
+			q += e.value;
+			break;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	free(map);
+
+	seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("Eventos: %lld; Ignorados: %lld; Quanta: %lld; CPUs: %d\n", events, skipped, q, simConfig.cpus);
+	printf("Tempo: %.3f s; Eventos/s: %.0f; Decisoes/s: %.0f; Decodificacao: %.0f eventos/s\n", seconds,
+		   seconds > 0 ? events / seconds : 0.0, seconds > 0 ? q * simConfig.cpus / seconds : 0.0,
+		   decode > 0 ? events / decode : 0.0);
+	printf("Processos: %d prontos, %d executando, %d aguardando\n", processCountByStatus(PROC_READY),
+		   processCountByStatus(PROC_RUNNING), processCountByStatus(PROC_WAITING));
+	printPoolStats();
+	for (k = 0; k < simNumSlots; k++)
+		printStats((int)k);
+	return plist;
+}
+
+/**
+ * @brief Funcao que desliga o rastreamento e a gravacao da carga
+ *
+ */
+void stopRecording(void)
+{
+	long events;
+
+	traceStop();
+	if (simConfig.record == NULL)
+		return;
+	events = wkldRecordStop();
+	if (events < 0)
+		fprintf(stderr, "Erro ao gravar a carga em %s\n", simConfig.record);
+	else if (simConfig.quanta > 0)
+		printf("Carga: %s; Eventos gravados: %ld\n", simConfig.record, events);
+}
+
+/**
+ * @brief Funcao que salva o estado da simulacao e do escalonador em um instantaneo
+ *
+ * @param plist processo do inicio
+ * @return int 1 caso o instantaneo seja salvo e 0, caso contrario
+ */
+int saveSnapshot(Process *plist)
+{
+	SimSnapInfo info;
+	Snapshot snap;
+	struct timespec start, end;
+	int ok;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (!snapCreate(&snap, simConfig.save))
+	{
+		fprintf(stderr, "Nao foi possivel criar o instantaneo %s\n", simConfig.save);
+		return 0;
+	}
+	memset(&info, 0, sizeof(info));
+	info.seed = simConfig.seed;
+	info.step = simStep;
+	info.rng = simRng;
+	info.cpus = simConfig.cpus;
+	info.events = simConfig.events;
+	info.processes = processCountByStatus(PROC_READY) + processCountByStatus(PROC_RUNNING) +
+					 processCountByStatus(PROC_WAITING) + processCountByStatus(PROC_INITIALIZING);
+	snapBeginSection(&snap, SNAP_SEC_SIM);
+	snapWrite(&snap, &info, sizeof(info));
+	ok = processSave(&snap, plist);
+	schedSave(&snap);
+	ok = lottSave(&snap) && ok;
+	if (simConfig.events)
+		twhlSave(&simWheel, &snap);
+	ok = snapFinish(&snap) && ok;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (!ok)
+		fprintf(stderr, "Erro ao salvar o instantaneo %s\n", simConfig.save);
+	else
+		printf("Instantaneo: %s; Processos: %d; Bytes: %llu; Tempo: %.3f s\n", simConfig.save, info.processes,
+			   (unsigned long long)snap.header.file_size,
+			   (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+	return ok;
+}
+
+/**
+ * @brief Funcao que restaura o estado salvo por saveSnapshot, no lugar da criacao dos processos
+ *
+ * As colunas e os indices sao copiados do arquivo mapeado; nenhum processo eh
+ * criado nem notificado, entao o custo eh proporcional ao tamanho do arquivo.
+ *
+ * @param snap instantaneo aberto
+ * @param plist saida com o processo do inicio
+ * @return int 1 caso o estado seja restaurado e 0, caso contrario
+ */
+int restoreSnapshot(Snapshot *snap, Process **plist)
+{
+	const SimSnapInfo *info;
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (!snapSeek(snap, SNAP_SEC_SIM) || (info = snapRead(snap, sizeof(SimSnapInfo))) == NULL ||
+		!processLoad(snap, plist) || !lottLoad(snap) || !schedLoad(snap) ||
+		(info->events && !twhlLoad(&simWheel, snap)))
+		return 0;
+	simRng = info->rng;
+	simStep = info->step;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Restaurado: %s; Processos: %d; Tempo: %.3f s\n", simConfig.restore, info->processes,
+		   (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+	return 1;
+}
+
+int main(int argc, char *argv[])
 {
 	int i = 0, step = 0;
 	char c = ' ';
-	Process *plist = NULL, *p1 = NULL;
+	char name[CURR_MAX_NAME_LEN]; // nome das moedas
+	Process *plist = NULL;
+	WorkloadTrace replay;		  // rastro de carga reproduzido
+	Snapshot snap;				  // instantaneo restaurado
+	const SimSnapInfo *saved = NULL; // estado da simulacao no instantaneo
 
-	srand(time(NULL));
+	if (!parseArgs(&simConfig, argc, argv))
+		return 1;
+	if (simConfig.replay != NULL) // a carga vem do rastro, com as CPUs gravadas
+	{
+		if (!wkldOpen(&replay, simConfig.replay) || replay.header.cpus < 1 || replay.header.cpus > SCHED_MAX_CPUS)
+		{
+			fprintf(stderr, "Nao foi possivel abrir o rastro de carga %s\n", simConfig.replay);
+			return 1;
+		}
+		simConfig.cpus = replay.header.cpus;
+		simConfig.currencies = 0;
+		simConfig.events = 0;
+		simConfig.processes = 0;
+		if (simConfig.verbose < 2) // reproducao silenciosa, como o modo sem interacao
+			simConfig.verbose = 0;
+	}
+
+	if (simConfig.restore != NULL) // CPUs, modo e semente vem do instantaneo
+	{
+		i = snapOpen(&snap, simConfig.restore);
+		if (i == 1 && snapSeek(&snap, SNAP_SEC_SIM))
+			saved = snapRead(&snap, sizeof(SimSnapInfo));
+		if (saved == NULL || saved->cpus < 1 || saved->cpus > SCHED_MAX_CPUS)
+		{
+			if (i == SNAP_ERR_FORMAT)
+				fprintf(stderr, "%s nao eh um instantaneo desta versao\n", simConfig.restore);
+			else if (i == SNAP_ERR_CORRUPT || i == 1)
+				fprintf(stderr, "Instantaneo %s corrompido\n", simConfig.restore);
+			else
+				fprintf(stderr, "Nao foi possivel abrir o instantaneo %s\n", simConfig.restore);
+			return 1;
+		}
+		simConfig.seed = saved->seed;
+		simConfig.cpus = saved->cpus;
+		simConfig.events = saved->events;
+		simConfig.processes = saved->processes; // so dimensiona os pools
+	}
+
+	printf("Semente: %llu\n", (unsigned long long)simConfig.seed); // permite reproduzir a execucao
+	rngSeed(&simRng, simConfig.seed);
+
+	// pre-aloca os registros de processos e parametros
+	processInitPool(1024 + simConfig.processes, 0);
+	lottInitParamsPool(1024 + simConfig.processes, 0);
+	twhlInit(&simWheel, 0);
 
 	// inicializa escalonadores de processos
 	schedInitSchedInfo();
-	lottInitSchedInfo();
+	if (!strcmp(simConfig.engine, "alia"))
+		aliasInitSchedInfo();
+	else if (!strcmp(simConfig.engine, "strd"))
+		strdInitSchedInfo();
+	else if (!strcmp(simConfig.engine, "misto")) // loteria e passos, cada um com metade da CPU
+	{
+		lottInitSchedInfo();
+		strdInitSchedInfo();
+		schedSetHierarchical(1);
+		simNumSlots = 2;
+	}
+	else
+		lottInitSchedInfo();
+	schedSetSeed(simConfig.seed + 2);
+	for (i = 0; i < simConfig.currencies; i++) // um grupo por moeda, todos com o mesmo financiamento
+	{
+		snprintf(name, sizeof(name), "grupo%d", i);
+		simCurrencies[i] = currCreate(name, NULL, SIM_CURRENCY_FUNDING);
+	}
+	lottSetSeed(simConfig.seed + 1); // sequencia do escalonador separada da simulacao
+	aliasSetSeed(simConfig.seed + 1);
+	lottSetVerbose(simConfig.verbose);
+	schedSetLatencyTracking(simConfig.latency);
+	schedSetNumCpus(simConfig.cpus);
+
+	if (simConfig.trace != NULL && !traceStart(simConfig.trace))
+	{
+		fprintf(stderr, "Nao foi possivel criar o rastro %s\n", simConfig.trace);
+		return 1;
+	}
+	if (simConfig.record != NULL && !wkldRecordStart(simConfig.record, simConfig.cpus))
+	{
+		fprintf(stderr, "Nao foi possivel criar o arquivo de carga %s\n", simConfig.record);
+		return 1;
+	}
+
+	if (simConfig.replay != NULL) // os processos sao criados pelo rastro
+	{
+		runReplay(plist, &replay);
+		wkldClose(&replay);
+		stopRecording();
+		return 0;
+	}
+
+	if (simConfig.restore != NULL) // partida a quente: processos, filas e geradores do instantaneo
+	{
+		i = restoreSnapshot(&snap, &plist);
+		snapClose(&snap);
+		if (!i)
+		{
+			fprintf(stderr, "Instantaneo %s invalido para esta configuracao\n", simConfig.restore);
+			return 1;
+		}
+	}
+	else
+	{
+		//cria o primeiro processo com PPID e tickets 1
+		plist = createProcess(plist, 1, 1);
+		for (i = 0; i < simConfig.processes; i++) // populacao inicial
+			plist = createProcess(plist, 1, ((int64_t)rngBounded(&simRng, 100) + 1) * 100);
+	}
+	i = 0;
+	SIM_PRINTF("\n");
 
-	//cria o primeiro processo com PPID e tickets 1
-	plist = createProcess(plist, 1, 1);
-	printf("\n");
+	if (simConfig.quanta > 0) // simulacao sem interacao
+	{
+		plist = runHeadless(plist);
+		stopRecording();
+		if (simConfig.save != NULL && !saveSnapshot(plist))
+			return 1;
+		return 0;
+	}
 
 	//realiza os casos para a iteracao com o usuario
 	while (c != 'n')
 	{
-		switch (i)
+		if (i == 0)
 		{
-		case 0:
 			printf("(Passo:%d)\n", step);
-			plist = randomActions(plist);
+			plist = simActions(plist);
 			printProcess(plist, dumpSchedParams);
 			printf("\n");
 			i++;
-			break;
-		case SCHED_ITERATIONS + 1:
+		}
+		else if (i == simConfig.iterations + 1)
+		{
 			printf("(Passo:%d/Iteracoes:%d)\n", step, i - 1);
 			printProcess(plist, dumpSchedParams);
+			printf("Tickets prontos: %" PRId64 "; Reconstrucoes do indice: %ld\n",
+				   lottGetTotalTickets(), lottGetRebuildCount());
 			step++;
 			i = 0;
 			printf("\nContinuar (s/n)? ");
 			fflush(stdout);
 			c = getchar();
 			printf("\n");
-			break;
-		default:
-			p1 = schedSchedule(plist);
+		}
+		else
+		{
+			scheduleQuantum(plist);
 			i++;
 		}
 	}
+	stopRecording();
+	if (simConfig.save != NULL && !saveSnapshot(plist))
+		return 1;
 	return 0;
 }
@@ -0,0 +1,203 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "pool.h"
+
+#define POOL_MIN_CHUNK 64				 // menor quantidade de objetos por bloco
+#define POOL_ALIGN 16					 // alinhamento dos objetos
+#define POOL_HUGEPAGE_SIZE (2UL << 20) // tamanho de uma pagina grande (2 MiB)
+
+struct pool_chunk
+{
+	PoolChunk *next; // proximo bloco
+	size_t bytes;	 // tamanho total do bloco
+	int mapped;		 // 1 se veio de mmap, 0 se veio de malloc
+	int huge;		 // 1 se usa paginas grandes (MAP_HUGETLB)
+};
+
+/**
+ * @brief Funcao que aloca a memoria de um bloco, usando paginas grandes quando pedido
+ *
+ * @param pool pool
+ * @param bytes tamanho desejado
+ * @return PoolChunk* bloco ou NULL, caso falte memoria
+ */
+static PoolChunk *poolMapChunk(Pool *pool, size_t bytes)
+{
+	PoolChunk *chunk = NULL;
+	void *mem;
+
+	if (pool->flags & POOL_HUGEPAGES)
+	{
+		bytes = (bytes + POOL_HUGEPAGE_SIZE - 1) & ~(POOL_HUGEPAGE_SIZE - 1); // arredonda para paginas grandes
+#ifdef MAP_HUGETLB
+		mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (mem != MAP_FAILED)
+		{
+			chunk = mem;
+			chunk->huge = 1;
+		}
+#endif
+		if (chunk == NULL) // sem paginas grandes reservadas, pede paginas grandes transparentes
+		{
+			mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (mem == MAP_FAILED)
+				return NULL;
+#ifdef MADV_HUGEPAGE
+			madvise(mem, bytes, MADV_HUGEPAGE);
+#endif
+			chunk = mem;
+			chunk->huge = 0;
+		}
+		chunk->mapped = 1;
+	}
+	else
+	{
+		chunk = malloc(bytes);
+		if (chunk == NULL)
+			return NULL;
+		chunk->mapped = 0;
+		chunk->huge = 0;
+	}
+
+	chunk->bytes = bytes;
+	return chunk;
+}
+
+/**
+ * @brief Funcao que adiciona um bloco com pelo menos count objetos a lista de livres
+ *
+ * @param pool pool
+ * @param count quantidade de objetos
+ * @return int 1 caso o bloco seja alocado e 0, caso contrario
+ */
+static int poolGrow(Pool *pool, long count)
+{
+	size_t header = (sizeof(PoolChunk) + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+	PoolChunk *chunk;
+	char *obj;
+	long i;
+
+	if (count < POOL_MIN_CHUNK)
+		count = POOL_MIN_CHUNK;
+
+	chunk = poolMapChunk(pool, header + count * pool->obj_size);
+	if (chunk == NULL)
+		return 0;
+	count = (chunk->bytes - header) / pool->obj_size; // aproveita o arredondamento das paginas grandes
+
+	chunk->next = pool->chunks;
+	pool->chunks = chunk;
+	pool->num_chunks++;
+	pool->capacity += count;
+
+	// encadeia os objetos do bloco na lista de livres, do ultimo para o primeiro
+	obj = (char *)chunk + header;
+	for (i = count - 1; i >= 0; i--)
+	{
+		*(void **)(obj + i * pool->obj_size) = pool->free_list;
+		pool->free_list = obj + i * pool->obj_size;
+	}
+	return 1;
+}
+
+/**
+ * @brief Funcao que inicializa um pool de objetos de tamanho fixo
+ *
+ * @param pool pool
+ * @param objSize tamanho de cada objeto
+ * @param prealloc quantidade de objetos pre-alocados
+ * @param flags opcoes (POOL_HUGEPAGES ou 0)
+ */
+void poolInit(Pool *pool, size_t objSize, long prealloc, int flags)
+{
+	if (objSize < sizeof(void *)) // o objeto livre guarda o ponteiro para o proximo
+		objSize = sizeof(void *);
+	pool->obj_size = (objSize + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+	pool->flags = flags;
+	pool->free_list = NULL;
+	pool->chunks = NULL;
+	pool->capacity = 0;
+	pool->live = 0;
+	pool->high_water = 0;
+	pool->num_chunks = 0;
+
+	if (prealloc > 0) // pre-alocacao em um unico bloco
+		poolGrow(pool, prealloc);
+}
+
+/**
+ * @brief Funcao que retorna um objeto livre do pool, alocando um novo bloco se necessario
+ *
+ * @param pool pool
+ * @return void* objeto ou NULL, caso falte memoria
+ */
+void *poolAlloc(Pool *pool)
+{
+	void *obj;
+
+	if (pool->free_list == NULL && !poolGrow(pool, pool->capacity)) // dobra a capacidade
+		return NULL;
+
+	obj = pool->free_list;
+	pool->free_list = *(void **)obj;
+	if (++pool->live > pool->high_water)
+		pool->high_water = pool->live;
+	return obj;
+}
+
+/**
+ * @brief Funcao que devolve um objeto ao pool
+ *
+ * @param pool pool
+ * @param obj objeto
+ */
+void poolFree(Pool *pool, void *obj)
+{
+	if (obj == NULL)
+		return;
+	*(void **)obj = pool->free_list;
+	pool->free_list = obj;
+	pool->live--;
+}
+
+/**
+ * @brief Funcao que libera todos os blocos do pool
+ *
+ * @param pool pool
+ */
+void poolDestroy(Pool *pool)
+{
+	PoolChunk *chunk, *next;
+
+	for (chunk = pool->chunks; chunk != NULL; chunk = next)
+	{
+		next = chunk->next;
+		if (chunk->mapped)
+			munmap(chunk, chunk->bytes);
+		else
+			free(chunk);
+	}
+	pool->chunks = NULL;
+	pool->free_list = NULL;
+	pool->capacity = pool->live = pool->num_chunks = 0;
+}
+
+/**
+ * @brief Funcao que preenche as estatisticas de uso do pool
+ *
+ * @param pool pool
+ * @param stats estatisticas
+ */
+void poolGetStats(Pool *pool, PoolStats *stats)
+{
+	PoolChunk *chunk;
+
+	stats->capacity = pool->capacity;
+	stats->live = pool->live;
+	stats->high_water = pool->high_water;
+	stats->num_chunks = pool->num_chunks;
+	stats->huge_chunks = 0;
+	for (chunk = pool->chunks; chunk != NULL; chunk = chunk->next)
+		stats->huge_chunks += chunk->huge;
+}
@@ -0,0 +1,72 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+#define POOL_HUGEPAGES 1 // tenta usar paginas grandes nos blocos do pool
+
+typedef struct pool_chunk PoolChunk;
+
+typedef struct pool
+{
+        size_t obj_size;    // tamanho de cada objeto (alinhado)
+        int flags;          // opcoes do pool (POOL_HUGEPAGES)
+        void *free_list;    // objetos livres encadeados pelo proprio espaco do objeto
+        PoolChunk *chunks;  // blocos alocados
+        long capacity;      // total de objetos nos blocos
+        long live;          // objetos em uso
+        long high_water;    // maior quantidade de objetos em uso ao mesmo tempo
+        long num_chunks;    // quantidade de blocos alocados
+} Pool;
+
+typedef struct pool_stats
+{
+        long capacity;      // total de objetos nos blocos
+        long live;          // objetos em uso
+        long high_water;    // maior quantidade de objetos em uso ao mesmo tempo
+        long num_chunks;    // quantidade de blocos alocados
+        long huge_chunks;   // blocos que usam paginas grandes
+} PoolStats;
+
+/**
+ * @brief Funcao que inicializa um pool de objetos de tamanho fixo
+ *
+ * @param pool pool
+ * @param objSize tamanho de cada objeto
+ * @param prealloc quantidade de objetos pre-alocados
+ * @param flags opcoes (POOL_HUGEPAGES ou 0)
+ */
+void poolInit(Pool *pool, size_t objSize, long prealloc, int flags);
+
+/**
+ * @brief Funcao que retorna um objeto livre do pool, alocando um novo bloco se necessario
+ *
+ * @param pool pool
+ * @return void* objeto ou NULL, caso falte memoria
+ */
+void *poolAlloc(Pool *pool);
+
+/**
+ * @brief Funcao que devolve um objeto ao pool
+ *
+ * @param pool pool
+ * @param obj objeto
+ */
+void poolFree(Pool *pool, void *obj);
+
+/**
+ * @brief Funcao que libera todos os blocos do pool
+ *
+ * @param pool pool
+ */
+void poolDestroy(Pool *pool);
+
+/**
+ * @brief Funcao que preenche as estatisticas de uso do pool
+ *
+ * @param pool pool
+ * @param stats estatisticas
+ */
+void poolGetStats(Pool *pool, PoolStats *stats);
+
+#endif
@@ -1,20 +1,306 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <pthread.h>
 #include "process.h"
 #include "scheduler.h"
+#include "pool.h"
+#include "proctable.h"
+#include "trace.h"
 
+// PID, status, slot e tickets ficam em colunas contiguas da tabela de processos
 struct proc
 {
-	int pid;			// Identificador do Processo
+	int handle;			// Posicao do processo na tabela de processos
 	int ppid;			// Identificador do Processo Pai
-	int status;			// Status do Processo
 	int cpu_usage;		// Tempo total de uso da CPU
-	int sched_slot;		// Slot do algoritmo de escalonamento associado
+	char lock;			// Trava do processo (status, tickets e parametros)
+	int64_t cpu_time;	// Tempo de CPU em fracoes de quantum (milesimos)
+	uint64_t retired;	// Epoca em que foi removido (aguardando os leitores)
 	void *sched_params; // Pont generico para parametros de escalonamento
 	struct proc *prev;	// Encadeamento processo anterior
 	struct proc *next;	// Encadeamento processo posterior
+	struct proc *state_prev; // Encadeamento anterior na lista do mesmo status
+	struct proc *state_next; // Encadeamento posterior na lista do mesmo status
 };
 
+#define NUM_STATUS 5 // quantidade de status possiveis
+#define PROC_TABLE_MIN 1024 // capacidade inicial da tabela de processos
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PROC_CPU_RELAX() __builtin_ia32_pause() // espera ativa mais leve para o outro nucleo
+#else
+#define PROC_CPU_RELAX() ((void)0)
+#endif
+
+// Listas intrusivas com os processos de cada status
+Process *state_heads[NUM_STATUS];
+int state_counts[NUM_STATUS];
+
+// Travas do nucleo concorrente: a trava de estrutura protege pool, tabela de processos,
+// tabela de PIDs e lista de processos; a trava de listas so as listas de status
+pthread_mutex_t processLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_spinlock_t processListLock;
+pthread_once_t processListLockOnce = PTHREAD_ONCE_INIT;
+int processPidSeed = 0; // ultimo PID gerado
+
+// Recuperacao por epocas: um processo removido so volta ao pool quando nenhum
+// leitor (CPU escalonando) pode ainda ter um ponteiro para ele
+uint64_t processEpoch = 1;							  // epoca global, avancada a cada remocao
+uint64_t processReaderEpoch[PROC_MAX_READERS];	  // epoca de cada leitor ativo (0 = fora de leitura)
+Process *processRetired = NULL;					  // processos removidos aguardando os leitores
+
+/**
+ * @brief Funcao que inicializa a trava das listas de status
+ *
+ */
+static void processInitListLock(void)
+{
+	pthread_spin_init(&processListLock, PTHREAD_PROCESS_PRIVATE);
+}
+
+// Tabela com as colunas contiguas dos processos
+ProcTable procTable;
+
+#define PROC_PID(p) (procTable.pid[(p)->handle])			// PID de um processo
+#define PROC_STATUS(p) (procTable.status[(p)->handle])	// status de um processo
+#define PROC_SLOT(p) (procTable.sched_slot[(p)->handle]) // slot de um processo
+
+// Pool com os registros dos processos
+Pool processPool;
+int processPoolReady = 0;
+
+#define PID_TABLE_MIN 16 // capacidade minima da tabela de PIDs
+
+// Tabela hash (enderecamento aberto, sondagem linear) indexada pelo PID
+Process **pid_table = NULL;
+int pid_capacity = 0; // sempre potencia de 2
+int pid_count = 0;	  // processos na tabela
+
+/**
+ * @brief Funcao que calcula a posicao inicial de um PID na tabela
+ *
+ * @param pid identificador do processo
+ * @return int posicao
+ */
+static int processPidSlot(int pid)
+{
+	return (int)(((unsigned int)pid * 2654435761u) & (unsigned int)(pid_capacity - 1)); // hash multiplicativo
+}
+
+/**
+ * @brief Funcao que insere um processo na tabela sem verificar a capacidade
+ *
+ * @param p processo
+ */
+static void processPidPut(Process *p)
+{
+	int i = processPidSlot(PROC_PID(p));
+	while (pid_table[i] != NULL) // sondagem linear ate a primeira posicao livre
+		i = (i + 1) & (pid_capacity - 1);
+	pid_table[i] = p;
+	pid_count++;
+}
+
+/**
+ * @brief Funcao que realoca a tabela de PIDs com uma nova capacidade
+ *
+ * @param capacity nova capacidade (potencia de 2)
+ */
+static void processPidResize(int capacity)
+{
+	Process **old = pid_table;
+	int i, oldCapacity = pid_capacity;
+
+	pid_table = calloc(capacity, sizeof(Process *));
+	pid_capacity = capacity;
+	pid_count = 0;
+	for (i = 0; i < oldCapacity; i++) // reinsere os processos existentes
+		if (old[i])
+			processPidPut(old[i]);
+	free(old);
+}
+
+/**
+ * @brief Funcao que insere um processo na tabela de PIDs, mantendo a ocupacao abaixo de 1/2
+ *
+ * @param p processo
+ */
+static void processPidInsert(Process *p)
+{
+	if (pid_table == NULL)
+		processPidResize(PID_TABLE_MIN);
+	else if ((pid_count + 1) * 2 > pid_capacity)
+		processPidResize(pid_capacity * 2);
+	processPidPut(p);
+}
+
+/**
+ * @brief Funcao que retorna a posicao de um PID na tabela
+ *
+ * @param pid identificador do processo
+ * @return int posicao ou -1, caso nao exista
+ */
+static int processPidFind(int pid)
+{
+	int i;
+	if (pid_table == NULL)
+		return -1;
+	for (i = processPidSlot(pid); pid_table[i] != NULL; i = (i + 1) & (pid_capacity - 1))
+		if (PROC_PID(pid_table[i]) == pid)
+			return i;
+	return -1;
+}
+
+/**
+ * @brief Funcao que remove um processo da tabela de PIDs
+ *
+ * Usa remocao com deslocamento para tras, entao a tabela nao acumula marcadores
+ * de remocao e a memoria acompanha a quantidade de processos vivos.
+ *
+ * @param p processo
+ */
+static void processPidRemove(Process *p)
+{
+	int i = processPidFind(PROC_PID(p)), j, home;
+	int mask = pid_capacity - 1;
+
+	if (i < 0)
+		return;
+	pid_table[i] = NULL;
+	pid_count--;
+
+	// puxa para o buraco os processos da sequencia que ficariam inalcancaveis
+	for (j = (i + 1) & mask; pid_table[j] != NULL; j = (j + 1) & mask)
+	{
+		home = processPidSlot(PROC_PID(pid_table[j]));
+		if (((j - home) & mask) >= ((j - i) & mask)) // posicao inicial nao esta entre o buraco e j
+		{
+			pid_table[i] = pid_table[j];
+			pid_table[j] = NULL;
+			i = j;
+		}
+	}
+
+	if (pid_capacity > PID_TABLE_MIN && pid_count * 8 < pid_capacity) // encolhe com a rotatividade de PIDs
+		processPidResize(pid_capacity / 2);
+}
+
+/**
+ * @brief Funcao que converte um status na posicao da sua lista
+ *
+ * @param status status
+ * @return int posicao da lista e -1, caso o status seja invalido
+ */
+static int processStatusIndex(int status)
+{
+	switch (status)
+	{
+	case PROC_INITIALIZING:
+		return 0;
+	case PROC_WAITING:
+		return 1;
+	case PROC_READY:
+		return 2;
+	case PROC_RUNNING:
+		return 3;
+	case PROC_TERMINATING:
+		return 4;
+	default:
+		return -1;
+	}
+}
+
+/**
+ * @brief Funcao que insere um processo no inicio da lista do seu status em O(1)
+ *
+ * @param p processo
+ */
+static void processStateLink(Process *p)
+{
+	int i = processStatusIndex(PROC_STATUS(p));
+	p->state_prev = NULL;
+	p->state_next = state_heads[i];
+	if (state_heads[i])
+		state_heads[i]->state_prev = p;
+	state_heads[i] = p;
+	state_counts[i]++;
+}
+
+/**
+ * @brief Funcao que retira um processo da lista de um status em O(1)
+ *
+ * @param p processo
+ * @param status status da lista em que o processo esta
+ */
+static void processStateUnlink(Process *p, int status)
+{
+	int i = processStatusIndex(status);
+	if (p->state_prev)
+		p->state_prev->state_next = p->state_next;
+	else
+		state_heads[i] = p->state_next;
+	if (p->state_next)
+		p->state_next->state_prev = p->state_prev;
+	p->state_prev = p->state_next = NULL;
+	state_counts[i]--;
+}
+
+/**
+ * @brief Funcao que devolve ao pool os processos removidos que nenhum leitor pode mais ver
+ *
+ * Chamada com a trava de estrutura. Um processo removido na epoca E eh liberado
+ * quando todos os leitores ativos entraram na epoca E ou depois.
+ *
+ */
+static void processReclaim(void)
+{
+	uint64_t min = UINT64_MAX, e;
+	Process **link = &processRetired, *p;
+	int i;
+
+	if (processRetired == NULL)
+		return;
+	for (i = 0; i < PROC_MAX_READERS; i++) // menor epoca entre os leitores ativos
+	{
+		e = __atomic_load_n(&processReaderEpoch[i], __ATOMIC_ACQUIRE);
+		if (e != 0 && e < min)
+			min = e;
+	}
+	while ((p = *link) != NULL)
+	{
+		if (p->retired <= min)
+		{
+			*link = p->next;
+			ptabFree(&procTable, p->handle);
+			poolFree(&processPool, p);
+		}
+		else
+			link = &p->next;
+	}
+}
+
+/**
+ * @brief Funcao que marca o inicio de uma leitura protegida (ponteiros obtidos de indices e filas)
+ *
+ * @param reader leitor (CPU), entre 0 e PROC_MAX_READERS - 1
+ */
+void processReadBegin(int reader)
+{
+	__atomic_store_n(&processReaderEpoch[reader], __atomic_load_n(&processEpoch, __ATOMIC_ACQUIRE), __ATOMIC_SEQ_CST);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST); // a epoca fica visivel antes das leituras
+}
+
+/**
+ * @brief Funcao que marca o fim de uma leitura protegida
+ *
+ * @param reader leitor (CPU)
+ */
+void processReadEnd(int reader)
+{
+	__atomic_store_n(&processReaderEpoch[reader], 0, __ATOMIC_RELEASE);
+}
+
 /**
  * @brief Funcao que retorna o PID (identificador do Processo) de um processo
  *
@@ -23,7 +309,7 @@ struct proc
  */
 int processGetPid(Process *p)
 {
-	return p->pid;
+	return PROC_PID(p);
 }
 
 /**
@@ -45,7 +331,7 @@ int processGetParentPid(Process *p)
  */
 int processGetStatus(Process *p)
 {
-	return p->status;
+	return __atomic_load_n(&PROC_STATUS(p), __ATOMIC_ACQUIRE);
 }
 
 /**
@@ -78,7 +364,7 @@ void *processGetSchedParams(Process *p)
  */
 int processGetSchedSlot(Process *p)
 {
-	return p->sched_slot;
+	return PROC_SLOT(p);
 }
 
 /**
@@ -112,11 +398,76 @@ Process *processGetPrev(Process *p)
  */
 int processSetParentPid(Process *p, int ppid)
 {
-	Process *found = processGetByPid(p, ppid); // retorna o processo
+	Process *found = processGetByPid(p, ppid); // retorna o processo (a trava de estrutura fica na busca)
 	if (!found)								   // se nao existe
 		return -1;							   // retorna negativo
 	p->ppid = ppid;							   // altera o PPID
-	return p->pid;							   // retorna o PID
+	return PROC_PID(p);							   // retorna o PID
+}
+
+/**
+ * @brief Funcao que trava um processo, esperando caso outra thread o tenha travado
+ *
+ * @param p processo
+ */
+void processLockProc(Process *p)
+{
+	while (__atomic_test_and_set(&p->lock, __ATOMIC_ACQUIRE))
+		while (__atomic_load_n(&p->lock, __ATOMIC_RELAXED)) // espera sem disputar a linha de cache
+			PROC_CPU_RELAX();
+}
+
+/**
+ * @brief Funcao que destrava um processo
+ *
+ * @param p processo
+ */
+void processUnlockProc(Process *p)
+{
+	__atomic_clear(&p->lock, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Funcao que verifica se uma transicao de status eh valida
+ *
+ * @param from status atual
+ * @param to novo status
+ * @return int 1 caso seja valida e 0, caso contrario
+ */
+static int processValidTransition(int from, int to)
+{
+	switch (from)
+	{
+	case PROC_INITIALIZING:	   // inicializando
+	case PROC_WAITING:		   // aguardando
+		return to == PROC_READY; // passa para pronto
+	case PROC_READY:			   // pronto
+		return to == PROC_RUNNING; // passa para executando
+	case PROC_RUNNING:									 // executando
+		return to == PROC_READY || to == PROC_WAITING; // passa para pronto ou aguardando
+	default:
+		return 0; // transicao invalida
+	}
+}
+
+/**
+ * @brief Funcao que troca o status de um processo travado, a sua lista e avisa o escalonador
+ *
+ * @param p processo (travado pela thread atual)
+ * @param oldStatus status atual
+ * @param status novo status
+ */
+static void processChangeStatus(Process *p, int oldStatus, int status)
+{
+	__atomic_store_n(&PROC_STATUS(p), status, __ATOMIC_RELEASE);
+	pthread_spin_lock(&processListLock);
+	processStateUnlink(p, oldStatus); // troca o processo de lista
+	processStateLink(p);
+	pthread_spin_unlock(&processListLock);
+	TRACE(TRACE_STATUS, 0, PROC_PID(p), oldStatus, status);
+	if (oldStatus == PROC_RUNNING) // deixou de executar: a CPU fica livre
+		schedReleaseCpu(p);
+	schedNotifyProcStatusChange(p); // notifica
 }
 
 /**
@@ -128,39 +479,40 @@ int processSetParentPid(Process *p, int ppid)
  */
 int processSetStatus(Process *p, int status)
 {
-	int idProcess = p->pid; // identificador do processo
-	switch (p->status)
-	{
-	case PROC_INITIALIZING:		  // inicializando
-		if (status == PROC_READY) // passa para pronto
-			p->status = status;	  // altera o status
-		else
-			idProcess = -1; // transicao invalida
-		break;
-	case PROC_READY:				// pronto
-		if (status == PROC_RUNNING) // passa para executando
-			p->status = status;		// altera o status
-		else
-			idProcess = -1; // transicao invalida
-		break;
-	case PROC_WAITING:			  // aguardando
-		if (status == PROC_READY) // passa para pronto
-			p->status = status;	  // altera o status
-		else
-			idProcess = -1; // transicao invalida
-		break;
-	case PROC_RUNNING:										// execurando
-		if (status == PROC_READY || status == PROC_WAITING) // passa para pronto ou aguardando
-			p->status = status;								// altera o status
-		else
-			idProcess = -1; // transicao invalida
-		break;
-	default:
+	int idProcess = PROC_PID(p); // identificador do processo
+	int oldStatus;				 // status anterior, para trocar de lista
+
+	processLockProc(p);
+	oldStatus = PROC_STATUS(p);
+	if (processValidTransition(oldStatus, status)) // verifica se eh valido
+		processChangeStatus(p, oldStatus, status);
+	else
 		idProcess = -1; // transicao invalida
-	}
-	if (idProcess == p->pid)			// verifica se eh valido
-		schedNotifyProcStatusChange(p); // notifica
-	return idProcess;					// retorna o identificador do processo
+	processUnlockProc(p);
+	return idProcess; // retorna o identificador do processo
+}
+
+/**
+ * @brief Funcao que altera o status de um processo somente se ele ainda estiver no status esperado
+ *
+ * @param p processo
+ * @param expected status esperado
+ * @param status novo status
+ * @return int identificador do processo e -1, caso o status tenha mudado ou a transicao seja invalida
+ */
+int processCompareAndSetStatus(Process *p, int expected, int status)
+{
+	int idProcess = PROC_PID(p);
+
+	if (__atomic_load_n(&PROC_STATUS(p), __ATOMIC_ACQUIRE) != expected) // falha rapida, sem travar
+		return -1;
+	processLockProc(p);
+	if (PROC_STATUS(p) == expected && processValidTransition(expected, status))
+		processChangeStatus(p, expected, status);
+	else
+		idProcess = -1; // outra thread mudou o status antes
+	processUnlockProc(p);
+	return idProcess;
 }
 
 /**
@@ -175,6 +527,29 @@ int processAddCpuUsage(Process *p, int add)
 	return p->cpu_usage += add;
 }
 
+/**
+ * @brief Funcao que retorna o tempo de CPU usado por um processo em fracoes de quantum
+ *
+ * @param p processo
+ * @return int64_t tempo de CPU em milesimos de quantum
+ */
+int64_t processGetCpuTime(Process *p)
+{
+	return p->cpu_time;
+}
+
+/**
+ * @brief Funcao que adiciona tempo de CPU em fracoes de quantum
+ *
+ * @param p processo
+ * @param add milesimos de quantum (negativo para devolver o que nao foi usado)
+ * @return int64_t tempo atualizado
+ */
+int64_t processAddCpuTime(Process *p, int64_t add)
+{
+	return p->cpu_time += add;
+}
+
 /**
  * @brief Funcao que redireciona ponteiro de parametros de escalonamento para uma estrutura
  *
@@ -194,7 +569,7 @@ void processSetSchedParams(Process *p, void *sp)
  */
 void processSetSchedSlot(Process *p, int slot)
 {
-	p->sched_slot = slot;
+	PROC_SLOT(p) = slot;
 }
 
 /**
@@ -206,10 +581,15 @@ void processSetSchedSlot(Process *p, int slot)
  */
 Process *processGetByPid(Process *plist, int pid)
 {
-	Process *current = plist;					   // recebe o processo
-	while (current != NULL && current->pid != pid) // verifica
-		current = current->next;				   // pega o processo
-	return current;								   // retorna
+	Process *found;
+	int i;
+	if (plist == NULL) // lista vazia
+		return NULL;
+	pthread_mutex_lock(&processLock);
+	i = processPidFind(pid); // consulta a tabela hash em O(1) medio
+	found = i < 0 ? NULL : pid_table[i];
+	pthread_mutex_unlock(&processLock);
+	return found;
 }
 
 /**
@@ -221,10 +601,44 @@ Process *processGetByPid(Process *plist, int pid)
  */
 Process *processGetByStatus(Process *plist, int status)
 {
-	Process *current = plist;							 // recebe o processo
-	while (current != NULL && current->status != status) // verifica
-		current = current->next;						 // pega o processo
-	return current;										 // retorna
+	if (plist == NULL) // lista vazia
+		return NULL;
+	return processFirstByStatus(status); // primeiro da lista do status, em O(1)
+}
+
+/**
+ * @brief Funcao que retorna o primeiro processo da lista de um status
+ *
+ * @param status status
+ * @return Process* processo ou NULL, caso nao exista
+ */
+Process *processFirstByStatus(int status)
+{
+	int i = processStatusIndex(status);
+	return i < 0 ? NULL : state_heads[i];
+}
+
+/**
+ * @brief Funcao que retorna o proximo processo com o mesmo status
+ *
+ * @param p processo
+ * @return Process* proximo processo ou NULL, caso seja o ultimo
+ */
+Process *processNextByStatus(Process *p)
+{
+	return p->state_next;
+}
+
+/**
+ * @brief Funcao que retorna a quantidade de processos em um status em O(1)
+ *
+ * @param status status
+ * @return int quantidade de processos
+ */
+int processCountByStatus(int status)
+{
+	int i = processStatusIndex(status);
+	return i < 0 ? 0 : state_counts[i];
 }
 
 /**
@@ -237,11 +651,84 @@ Process *processGetByStatus(Process *plist, int status)
 Process *processGetBySchedSlot(Process *plist, int slot)
 {
 	Process *current = plist;
-	while (current != NULL && current->sched_slot != slot)
+	while (current != NULL && PROC_SLOT(current) != slot)
 		current = current->next;
 	return current;
 }
 
+/**
+ * @brief Funcao que retorna a posicao estavel (handle) de um processo na tabela de processos
+ *
+ * @param p processo
+ * @return int handle
+ */
+int processGetHandle(Process *p)
+{
+	return p->handle;
+}
+
+/**
+ * @brief Funcao que retorna o numero de tickets de um processo
+ *
+ * @param p processo
+ * @return int64_t numero de tickets
+ */
+int64_t processGetTickets(Process *p)
+{
+	return procTable.tickets[p->handle];
+}
+
+/**
+ * @brief Funcao que altera o numero de tickets de um processo na tabela de processos
+ *
+ * @param p processo
+ * @param tickets numero de tickets
+ */
+void processSetTickets(Process *p, int64_t tickets)
+{
+	procTable.tickets[p->handle] = tickets;
+}
+
+/**
+ * @brief Funcao que retorna a tabela de processos, para passadas lineares sobre as colunas
+ *
+ * @return ProcTable* tabela de processos
+ */
+ProcTable *processGetTable(void)
+{
+	return &procTable;
+}
+
+/**
+ * @brief Funcao que inicializa o pool de registros de processos
+ *
+ * @param prealloc quantidade de processos pre-alocados
+ * @param flags opcoes do pool (POOL_HUGEPAGES ou 0)
+ */
+void processInitPool(long prealloc, int flags)
+{
+	pthread_once(&processListLockOnce, &processInitListLock);
+	pthread_mutex_lock(&processLock);
+	if (!processPoolReady) // ja existem processos no pool atual
+	{
+		poolInit(&processPool, sizeof(Process), prealloc, flags);
+		if (procTable.capacity == 0) // tabela pre-alocada junto, para nao crescer durante o escalonamento
+			ptabInit(&procTable, prealloc > PROC_TABLE_MIN ? (int)prealloc : PROC_TABLE_MIN);
+		processPoolReady = 1;
+	}
+	pthread_mutex_unlock(&processLock);
+}
+
+/**
+ * @brief Funcao que preenche as estatisticas do pool de registros de processos
+ *
+ * @param stats estatisticas
+ */
+void processGetPoolStats(PoolStats *stats)
+{
+	poolGetStats(&processPool, stats);
+}
+
 /**
  * @brief Funcao que cria um processo no inicio da lista
  *
@@ -250,15 +737,24 @@ Process *processGetBySchedSlot(Process *plist, int slot)
  */
 Process *processCreate(Process *plist)
 {
-	static int pidseed = 0;
 	// inicializar os atributos do processo
-	Process *newp = malloc(sizeof(Process));
-	newp->pid = ++pidseed;
+	Process *newp;
+	if (!processPoolReady) // pool sem pre-alocacao caso processInitPool nao tenha sido chamada
+		processInitPool(0, 0);
+	pthread_mutex_lock(&processLock);
+	processReclaim(); // reaproveita os removidos que ja nao sao vistos
+	newp = poolAlloc(&processPool);
+	newp->handle = ptabAlloc(&procTable, newp); // status inicializando e sem slot
+	PROC_PID(newp) = ++processPidSeed;
+	newp->lock = 0;
 	newp->ppid = 0;
-	newp->status = PROC_INITIALIZING;
 	newp->cpu_usage = 0;
+	newp->cpu_time = 0;
 	newp->sched_params = NULL;
-	newp->sched_slot = -1;
+	pthread_spin_lock(&processListLock);
+	processStateLink(newp); // entra na lista de inicializando
+	pthread_spin_unlock(&processListLock);
+	processPidInsert(newp); // entra na tabela de PIDs
 	if (plist) // Se lista de processos nao for vazia, encadear no inicio dela
 	{
 		// ajusta os ponteiros
@@ -271,6 +767,7 @@ Process *processCreate(Process *plist)
 		newp->next = NULL;
 		newp->prev = newp;
 	}
+	pthread_mutex_unlock(&processLock);
 	return newp; // retorna o processo
 }
 
@@ -283,7 +780,12 @@ Process *processCreate(Process *plist)
  */
 Process *processDestroy(Process *plist, int pid)
 {
-	Process *found = processGetByPid(plist, pid); // retorna o processo atraves do seu identificador
+	Process *found = NULL;
+	int i;
+
+	pthread_mutex_lock(&processLock); // busca e remocao sem outra thread no meio
+	if (plist && (i = processPidFind(pid)) >= 0)
+		found = pid_table[i]; // retorna o processo atraves do seu identificador
 
 	if (found) // se foi encontrado
 	{
@@ -305,18 +807,321 @@ Process *processDestroy(Process *plist, int pid)
 			found->prev->next = found->next;
 		}
 
+		processLockProc(found);		   // nenhuma troca de status nem reivindicacao durante a remocao
+		schedNotifyProcDestroy(found); // libera a CPU, se estiver executando
+		pthread_spin_lock(&processListLock);
+		processStateUnlink(found, PROC_STATUS(found)); // sai da lista do seu status
+		pthread_spin_unlock(&processListLock);
+		processPidRemove(found); // sai da tabela de PIDs
+
 		//retorna as informacoes e remove
-		sched = schedGetSchedInfo(found->sched_slot);
+		sched = schedGetSchedInfo(PROC_SLOT(found));
 		if (sched)
 			sched->releaseParamsFn(found);
 		found->sched_params = NULL;
 		found->prev = NULL;
-		found->next = NULL;
-		free(found);
+		procTable.status[found->handle] = PTAB_FREE; // reivindicacoes atrasadas falham
+		processUnlockProc(found);
+
+		// o registro e o handle so sao reaproveitados depois dos leitores atuais
+		found->retired = __atomic_add_fetch(&processEpoch, 1, __ATOMIC_SEQ_CST);
+		found->next = processRetired;
+		processRetired = found;
+		processReclaim();
 	}
+	pthread_mutex_unlock(&processLock);
 	return plist;
 }
 
+// cabecalho da secao de processos no instantaneo
+typedef struct proc_snap_info
+{
+	int32_t size;					  // posicoes usadas da tabela
+	int32_t num_free;				  // posicoes livres
+	int32_t count;					  // processos vivos
+	int32_t pid_seed;				  // ultimo PID gerado
+	int32_t state_counts[NUM_STATUS]; // processos em cada lista de status
+	int32_t reserved;
+} ProcSnapInfo;
+
+/**
+ * @brief Funcao que grava no instantaneo a tabela de processos e a ordem das listas
+ *
+ * @param s instantaneo em gravacao
+ * @param plist processo do inicio
+ * @return int 1 caso a secao seja gravada e 0, caso contrario
+ */
+int processSave(Snapshot *s, Process *plist)
+{
+	ProcSnapInfo info;
+	Process *p;
+	int *handles, *ppid, *usage;
+	int64_t *time;
+	int h, i, n, ok;
+
+	pthread_mutex_lock(&processLock);
+	processReclaim(); // sem leitores ativos, os removidos voltam ao pool e liberam o handle
+	memset(&info, 0, sizeof(info));
+	info.size = procTable.size;
+	info.num_free = procTable.num_free;
+	info.count = pid_count;
+	info.pid_seed = processPidSeed;
+	for (i = 0; i < NUM_STATUS; i++)
+		info.state_counts[i] = state_counts[i];
+
+	// campos dos registros em colunas, como as da tabela
+	handles = malloc((info.size + 1) * sizeof(int));
+	ppid = malloc((info.size + 1) * sizeof(int));
+	usage = malloc((info.size + 1) * sizeof(int));
+	time = malloc((info.size + 1) * sizeof(int64_t));
+	for (h = 0; h < info.size; h++)
+	{
+		p = procTable.proc[h];
+		ppid[h] = p ? p->ppid : 0;
+		usage[h] = p ? p->cpu_usage : 0;
+		time[h] = p ? p->cpu_time : 0;
+	}
+
+	snapBeginSection(s, SNAP_SEC_PROC);
+	snapWrite(s, &info, sizeof(info));
+	snapWrite(s, procTable.pid, info.size * sizeof(int));
+	snapWrite(s, procTable.status, info.size * sizeof(int));
+	snapWrite(s, procTable.sched_slot, info.size * sizeof(int));
+	snapWrite(s, procTable.tickets, info.size * sizeof(int64_t));
+	snapWrite(s, procTable.free_handles, info.num_free * sizeof(int));
+	snapWrite(s, ppid, info.size * sizeof(int));
+	snapWrite(s, usage, info.size * sizeof(int));
+	snapWrite(s, time, info.size * sizeof(int64_t));
+
+	// ordem da lista de processos e de cada lista de status, por handle
+	for (n = 0, p = plist; p != NULL && n < info.count; p = p->next)
+		handles[n++] = p->handle;
+	ok = n == info.count && p == NULL && processRetired == NULL;
+	snapWrite(s, handles, n * sizeof(int));
+	for (i = 0; i < NUM_STATUS; i++)
+	{
+		for (n = 0, p = state_heads[i]; p != NULL; p = p->state_next)
+			handles[n++] = p->handle;
+		snapWrite(s, handles, n * sizeof(int));
+	}
+	pthread_mutex_unlock(&processLock);
+
+	free(handles);
+	free(ppid);
+	free(usage);
+	free(time);
+	return ok && !s->error;
+}
+
+/**
+ * @brief Funcao que marca um handle no mapa de bits dos handles ja vistos
+ *
+ * @param seen mapa de bits
+ * @param h handle
+ * @return int 1 caso o handle ainda nao tenha sido visto e 0, caso contrario
+ */
+static int processMarkHandle(uint64_t *seen, int h)
+{
+	uint64_t bit = 1ULL << (h & 63);
+
+	if (seen[h >> 6] & bit)
+		return 0;
+	seen[h >> 6] |= bit;
+	return 1;
+}
+
+/**
+ * @brief Funcao que confere se os handles de uma lista gravada sao de processos vivos com o status esperado
+ *
+ * Um handle repetido fecharia um ciclo na lista restaurada, entao tambem eh recusado.
+ *
+ * @param handles handles
+ * @param n quantidade de handles
+ * @param size posicoes da tabela gravada
+ * @param status status de cada posicao
+ * @param list lista de status esperada ou -1 para qualquer status
+ * @return int 1 caso a lista seja valida e 0, caso contrario
+ */
+static int processCheckHandles(const int *handles, int n, int size, const int *status, int list)
+{
+	uint64_t *seen;
+	int i;
+
+	if (handles == NULL || (seen = calloc(size / 64 + 1, sizeof(uint64_t))) == NULL)
+		return 0;
+	for (i = 0; i < n; i++)
+		if (handles[i] < 0 || handles[i] >= size || status[handles[i]] == PTAB_FREE ||
+			(list >= 0 && processStatusIndex(status[handles[i]]) != list) || !processMarkHandle(seen, handles[i]))
+			break;
+	free(seen);
+	return i == n;
+}
+
+/**
+ * @brief Funcao que confere se os PIDs gravados dos processos vivos sao positivos, distintos e nao passam do ultimo gerado
+ *
+ * Os PIDs ja vistos ficam em uma tabela hash temporaria, como a tabela de PIDs.
+ *
+ * @param pid PID de cada posicao
+ * @param status status de cada posicao
+ * @param size posicoes da tabela gravada
+ * @param count processos vivos
+ * @param seed ultimo PID gerado
+ * @return int 1 caso os PIDs sejam validos e 0, caso contrario
+ */
+static int processCheckPids(const int *pid, const int *status, int size, int count, int seed)
+{
+	int *seen, capacity, h, i;
+
+	for (capacity = PID_TABLE_MIN; capacity < count * 2; capacity *= 2)
+		;
+	if ((seen = calloc(capacity, sizeof(int))) == NULL) // 0 marca posicao livre
+		return 0;
+	for (h = 0; h < size; h++)
+	{
+		if (status[h] == PTAB_FREE)
+			continue;
+		if (pid[h] <= 0 || pid[h] > seed) // o proximo processCreate repetiria o PID
+			break;
+		i = (int)(((unsigned int)pid[h] * 2654435761u) & (unsigned int)(capacity - 1));
+		while (seen[i] != 0 && seen[i] != pid[h])
+			i = (i + 1) & (capacity - 1);
+		if (seen[i] == pid[h]) // PID repetido
+			break;
+		seen[i] = pid[h];
+	}
+	free(seen);
+	return h == size;
+}
+
+/**
+ * @brief Funcao que restaura a tabela de processos de um instantaneo, com os mesmos handles e PIDs
+ *
+ * Todo o conteudo da secao eh conferido antes da primeira alteracao.
+ *
+ * @param s instantaneo aberto
+ * @param plist saida com o processo do inicio
+ * @return int 1 caso a tabela seja restaurada e 0, caso contrario (nada eh alterado)
+ */
+int processLoad(Snapshot *s, Process **plist)
+{
+	const ProcSnapInfo *info;
+	const int *pid, *status, *slot, *freeh, *ppid, *usage, *order, *lists[NUM_STATUS];
+	const int64_t *tickets, *time;
+	Process *p, *head = NULL, *prev = NULL;
+	uint64_t *seen;
+	int h, i, j, n, total = 0, capacity;
+
+	if (!snapSeek(s, SNAP_SEC_PROC) || (info = snapRead(s, sizeof(ProcSnapInfo))) == NULL)
+		return 0;
+	n = info->size;
+	if (n < 0 || info->num_free < 0 || info->num_free > n || info->count != n - info->num_free)
+		return 0;
+	pid = snapRead(s, n * sizeof(int));
+	status = snapRead(s, n * sizeof(int));
+	slot = snapRead(s, n * sizeof(int));
+	tickets = snapRead(s, n * sizeof(int64_t));
+	freeh = snapRead(s, info->num_free * sizeof(int));
+	ppid = snapRead(s, n * sizeof(int));
+	usage = snapRead(s, n * sizeof(int));
+	time = snapRead(s, n * sizeof(int64_t));
+	if (s->error)
+		return 0;
+
+	// confere status, posicoes livres e listas antes de alterar qualquer estrutura
+	for (h = 0; h < n; h++)
+		if (status[h] != PTAB_FREE && processStatusIndex(status[h]) < 0)
+			return 0;
+	if ((seen = calloc(n / 64 + 1, sizeof(uint64_t))) == NULL)
+		return 0;
+	for (i = 0; i < info->num_free; i++) // uma posicao livre repetida seria entregue a dois processos
+		if (freeh[i] < 0 || freeh[i] >= n || status[freeh[i]] != PTAB_FREE || !processMarkHandle(seen, freeh[i]))
+			break;
+	free(seen);
+	if (i < info->num_free)
+		return 0;
+	order = snapRead(s, info->count * sizeof(int));
+	if (!processCheckHandles(order, info->count, n, status, -1))
+		return 0;
+	for (i = 0; i < NUM_STATUS; i++)
+	{
+		if (info->state_counts[i] < 0 || (total += info->state_counts[i]) > info->count)
+			return 0;
+		lists[i] = snapRead(s, info->state_counts[i] * sizeof(int));
+		if (!processCheckHandles(lists[i], info->state_counts[i], n, status, i))
+			return 0;
+	}
+	if (total != info->count || !processCheckPids(pid, status, n, info->count, info->pid_seed))
+		return 0;
+
+	if (!processPoolReady)
+		processInitPool(info->count, 0);
+	pthread_mutex_lock(&processLock);
+	if (procTable.size != 0 || pid_count != 0) // so em uma tabela vazia
+	{
+		pthread_mutex_unlock(&processLock);
+		return 0;
+	}
+
+	// colunas copiadas direto do arquivo mapeado
+	ptabReserve(&procTable, n);
+	memcpy(procTable.pid, pid, n * sizeof(int));
+	memcpy(procTable.status, status, n * sizeof(int));
+	memcpy(procTable.sched_slot, slot, n * sizeof(int));
+	memcpy(procTable.tickets, tickets, n * sizeof(int64_t));
+	memcpy(procTable.free_handles, freeh, info->num_free * sizeof(int));
+	procTable.size = n;
+	procTable.num_free = info->num_free;
+
+	// um registro por posicao ocupada; a tabela de PIDs ja nasce com a capacidade final
+	for (capacity = PID_TABLE_MIN; capacity < info->count * 2; capacity *= 2)
+		;
+	processPidResize(capacity);
+	for (h = 0; h < n; h++)
+	{
+		procTable.proc[h] = NULL;
+		if (status[h] == PTAB_FREE)
+			continue;
+		p = poolAlloc(&processPool);
+		p->handle = h;
+		p->ppid = ppid[h];
+		p->cpu_usage = usage[h];
+		p->cpu_time = time[h];
+		p->lock = 0;
+		p->retired = 0;
+		p->sched_params = NULL;
+		p->prev = p->next = p->state_prev = p->state_next = NULL;
+		procTable.proc[h] = p;
+		processPidPut(p);
+	}
+
+	// lista de processos: o anterior do primeiro eh o ultimo, como em processCreate
+	for (i = 0; i < info->count; i++)
+	{
+		p = procTable.proc[order[i]];
+		p->prev = prev;
+		if (prev)
+			prev->next = p;
+		else
+			head = p;
+		prev = p;
+	}
+	if (head)
+		head->prev = prev;
+
+	// listas de status na ordem gravada (processStateLink insere no inicio)
+	pthread_spin_lock(&processListLock);
+	for (i = 0; i < NUM_STATUS; i++)
+		for (j = info->state_counts[i] - 1; j >= 0; j--)
+			processStateLink(procTable.proc[lists[i][j]]);
+	pthread_spin_unlock(&processListLock);
+
+	processPidSeed = info->pid_seed;
+	pthread_mutex_unlock(&processLock);
+	*plist = head;
+	return 1;
+}
+
 /**
  * @brief Funcao que imprime a lista de processo
  * 
@@ -329,7 +1134,7 @@ void printProcess(Process *plist, void (*dumpSchedParamsFn)(Process *p))
 	while (current != NULL)
 	{
 		printf("PID: %d; STATUS: %d; CPU: %d; ",
-			   current->pid, current->status, current->cpu_usage);
+			   PROC_PID(current), PROC_STATUS(current), current->cpu_usage);
 		dumpSchedParamsFn(current);
 		printf("\n");
 		current = current->next;
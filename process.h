@@ -2,6 +2,9 @@
 #define PROCESS_H
 
 #include <stdlib.h>
+#include <stdint.h>
+#include "pool.h"
+#include "snapshot.h"
 
 #define PROC_INITIALIZING 0 // inicializando
 #define PROC_WAITING 2      // aguardando
@@ -11,6 +14,8 @@
 
 typedef struct proc Process;
 
+#define PROC_MAX_READERS 65 // leitores com recuperacao por epocas (um por CPU e um do sorteio em lote)
+
 /**
  * @brief Funcao que retorna o PID (identificador do Processo) de um processo
  *
@@ -93,6 +98,50 @@ int processSetParentPid(Process *p, int ppid);
  */
 int processSetStatus(Process *p, int status);
 
+/**
+ * @brief Funcao que altera o status de um processo somente se ele ainda estiver no status esperado
+ *
+ * Usada para reivindicar o vencedor de um sorteio (READY para RUNNING) quando
+ * varias CPUs escalonam ao mesmo tempo: so uma delas consegue.
+ *
+ * @param p processo
+ * @param expected status esperado
+ * @param status novo status
+ * @return int identificador do processo e -1, caso o status tenha mudado ou a transicao seja invalida
+ */
+int processCompareAndSetStatus(Process *p, int expected, int status);
+
+/**
+ * @brief Funcao que marca o inicio de uma leitura protegida (ponteiros obtidos de indices e filas)
+ *
+ * Enquanto a leitura durar, processos removidos por outras threads nao voltam
+ * ao pool, entao o ponteiro sorteado continua valido ate ser reivindicado.
+ *
+ * @param reader leitor (CPU), entre 0 e PROC_MAX_READERS - 1
+ */
+void processReadBegin(int reader);
+
+/**
+ * @brief Funcao que marca o fim de uma leitura protegida
+ *
+ * @param reader leitor (CPU)
+ */
+void processReadEnd(int reader);
+
+/**
+ * @brief Funcao que trava um processo (status, tickets e parametros), esperando caso outra thread o tenha travado
+ *
+ * @param p processo
+ */
+void processLockProc(Process *p);
+
+/**
+ * @brief Funcao que destrava um processo
+ *
+ * @param p processo
+ */
+void processUnlockProc(Process *p);
+
 /**
  * @brief Funcao que adiciona o tempo da CPU
  *
@@ -102,6 +151,23 @@ int processSetStatus(Process *p, int status);
  */
 int processAddCpuUsage(Process *p, int add);
 
+/**
+ * @brief Funcao que retorna o tempo de CPU usado por um processo em fracoes de quantum
+ *
+ * @param p processo
+ * @return int64_t tempo de CPU em milesimos de quantum
+ */
+int64_t processGetCpuTime(Process *p);
+
+/**
+ * @brief Funcao que adiciona tempo de CPU em fracoes de quantum
+ *
+ * @param p processo
+ * @param add milesimos de quantum (negativo para devolver o que nao foi usado)
+ * @return int64_t tempo atualizado
+ */
+int64_t processAddCpuTime(Process *p, int64_t add);
+
 /**
  * @brief Funcao que redireciona ponteiro de parametros de escalonamento para uma estrutura
  *
@@ -136,6 +202,33 @@ Process *processGetByPid(Process *plist, int pid);
  */
 Process *processGetByStatus(Process *plist, int status);
 
+/**
+ * @brief Funcao que retorna o primeiro processo da lista de um status
+ *
+ * @param status status
+ * @return Process* processo ou NULL, caso nao exista
+ */
+Process *processFirstByStatus(int status);
+
+/**
+ * @brief Funcao que retorna o proximo processo com o mesmo status
+ *
+ * Alterar o status do processo durante a iteracao o move para outra lista,
+ * entao o proximo deve ser obtido antes da alteracao.
+ *
+ * @param p processo
+ * @return Process* proximo processo ou NULL, caso seja o ultimo
+ */
+Process *processNextByStatus(Process *p);
+
+/**
+ * @brief Funcao que retorna a quantidade de processos em um status em O(1)
+ *
+ * @param status status
+ * @return int quantidade de processos
+ */
+int processCountByStatus(int status);
+
 /**
  * @brief Funcao que retorna um processo a partir de um algoritmo de escalonamento que eh identificado pelo seu slot
  *
@@ -145,6 +238,49 @@ Process *processGetByStatus(Process *plist, int status);
  */
 Process *processGetBySchedSlot(Process *plist, int slot);
 
+/**
+ * @brief Funcao que retorna a posicao estavel (handle) de um processo na tabela de processos
+ *
+ * @param p processo
+ * @return int handle
+ */
+int processGetHandle(Process *p);
+
+/**
+ * @brief Funcao que retorna o numero de tickets de um processo
+ *
+ * @param p processo
+ * @return int64_t numero de tickets
+ */
+int64_t processGetTickets(Process *p);
+
+/**
+ * @brief Funcao que altera o numero de tickets de um processo na tabela de processos
+ *
+ * Mantido pelo escalonador, para que somas e filtros sejam passadas lineares na tabela.
+ *
+ * @param p processo
+ * @param tickets numero de tickets
+ */
+void processSetTickets(Process *p, int64_t tickets);
+
+/**
+ * @brief Funcao que inicializa o pool de registros de processos
+ *
+ * Deve ser chamada antes do primeiro processCreate; sem ela o pool comeca vazio.
+ *
+ * @param prealloc quantidade de processos pre-alocados
+ * @param flags opcoes do pool (POOL_HUGEPAGES ou 0)
+ */
+void processInitPool(long prealloc, int flags);
+
+/**
+ * @brief Funcao que preenche as estatisticas do pool de registros de processos
+ *
+ * @param stats estatisticas
+ */
+void processGetPoolStats(PoolStats *stats);
+
 /**
  * @brief Funcao que cria um processo no inicio da lista
  *
@@ -162,6 +298,31 @@ Process *processCreate(Process *plist);
  */
 Process *processDestroy(Process *plist, int pid);
 
+/**
+ * @brief Funcao que grava no instantaneo a tabela de processos e a ordem das listas
+ *
+ * Deve ser chamada sem outras threads escalonando, para que os processos
+ * removidos ja tenham voltado ao pool.
+ *
+ * @param s instantaneo em gravacao
+ * @param plist processo do inicio
+ * @return int 1 caso a secao seja gravada e 0, caso contrario
+ */
+int processSave(Snapshot *s, Process *plist);
+
+/**
+ * @brief Funcao que restaura a tabela de processos de um instantaneo, com os mesmos handles e PIDs
+ *
+ * As colunas sao copiadas do arquivo e as listas refeitas na ordem gravada, sem
+ * notificar escalonadores. Os parametros de escalonamento ficam a cargo do
+ * escalonador. So eh possivel restaurar antes do primeiro processCreate.
+ *
+ * @param s instantaneo aberto
+ * @param plist saida com o processo do inicio
+ * @return int 1 caso a tabela seja restaurada e 0, caso contrario (nada eh alterado)
+ */
+int processLoad(Snapshot *s, Process **plist);
+
 /**
  * @brief Funcao que imprime a lista de processo
  *
@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include "proctable.h"
+#include "ticketkernels.h"
+
+/**
+ * @brief Funcao que ajusta o tamanho de todas as colunas da tabela
+ *
+ * @param table tabela
+ * @param capacity nova capacidade
+ */
+static void ptabResize(ProcTable *table, int capacity)
+{
+	table->pid = realloc(table->pid, capacity * sizeof(int));
+	table->status = realloc(table->status, capacity * sizeof(int));
+	table->sched_slot = realloc(table->sched_slot, capacity * sizeof(int));
+	table->tickets = realloc(table->tickets, capacity * sizeof(int64_t));
+	table->proc = realloc(table->proc, capacity * sizeof(Process *));
+	table->free_handles = realloc(table->free_handles, capacity * sizeof(int));
+	table->capacity = capacity;
+}
+
+/**
+ * @brief Funcao que inicializa uma tabela de processos vazia
+ *
+ * @param table tabela
+ * @param capacity capacidade inicial
+ */
+void ptabInit(ProcTable *table, int capacity)
+{
+	table->pid = NULL;
+	table->status = NULL;
+	table->sched_slot = NULL;
+	table->tickets = NULL;
+	table->proc = NULL;
+	table->free_handles = NULL;
+	table->num_free = 0;
+	table->size = 0;
+	ptabResize(table, capacity < 1 ? 1 : capacity);
+}
+
+/**
+ * @brief Funcao que garante capacidade para uma quantidade de posicoes, de uma vez
+ *
+ * @param table tabela
+ * @param capacity capacidade minima
+ */
+void ptabReserve(ProcTable *table, int capacity)
+{
+	if (capacity > table->capacity)
+		ptabResize(table, capacity);
+}
+
+/**
+ * @brief Funcao que reserva uma posicao (handle) estavel para um processo
+ *
+ * @param table tabela
+ * @param p processo
+ * @return int handle do processo
+ */
+int ptabAlloc(ProcTable *table, Process *p)
+{
+	int h;
+
+	if (table->num_free > 0) // reaproveita uma posicao liberada
+		h = table->free_handles[--table->num_free];
+	else
+	{
+		if (table->size == table->capacity)
+			ptabResize(table, table->capacity * 2);
+		h = table->size++;
+	}
+
+	table->pid[h] = 0;
+	table->status[h] = PROC_INITIALIZING;
+	table->sched_slot[h] = -1;
+	table->tickets[h] = 0;
+	table->proc[h] = p;
+	return h;
+}
+
+/**
+ * @brief Funcao que libera a posicao de um processo
+ *
+ * @param table tabela
+ * @param handle handle do processo
+ */
+void ptabFree(ProcTable *table, int handle)
+{
+	table->status[handle] = PTAB_FREE; // passadas lineares ignoram a posicao
+	table->tickets[handle] = 0;
+	table->proc[handle] = NULL;
+	table->free_handles[table->num_free++] = handle;
+}
+
+/**
+ * @brief Funcao que calcula as somas acumuladas dos tickets das posicoes com um status
+ *
+ * @param table tabela
+ * @param status status
+ * @param prefix saida com as somas acumuladas
+ * @return int64_t soma total
+ */
+int64_t ptabPrefixTickets(ProcTable *table, int status, int64_t *prefix)
+{
+	return tkMaskedPrefixSum(table->tickets, table->status, status, table->size, prefix);
+}
@@ -0,0 +1,74 @@
+#ifndef PROCTABLE_H
+#define PROCTABLE_H
+
+#include <stdint.h>
+#include "process.h"
+
+#define PTAB_FREE -1 // status de uma posicao livre da tabela
+
+typedef struct proc_table
+{
+        int *pid;          // identificador do processo de cada posicao
+        int *status;       // status de cada posicao (PTAB_FREE se livre)
+        int *sched_slot;   // slot do algoritmo de escalonamento de cada posicao
+        int64_t *tickets;  // tickets de cada posicao
+        Process **proc;    // registro do processo de cada posicao
+        int *free_handles; // pilha de posicoes livres
+        int num_free;      // quantidade de posicoes livres
+        int size;          // quantidade de posicoes ja utilizadas
+        int capacity;      // capacidade alocada
+} ProcTable;
+
+/**
+ * @brief Funcao que retorna a tabela de processos, para passadas lineares sobre as colunas
+ *
+ * @return ProcTable* tabela de processos
+ */
+ProcTable *processGetTable(void);
+
+/**
+ * @brief Funcao que inicializa uma tabela de processos vazia
+ *
+ * @param table tabela
+ * @param capacity capacidade inicial
+ */
+void ptabInit(ProcTable *table, int capacity);
+
+/**
+ * @brief Funcao que garante capacidade para uma quantidade de posicoes, de uma vez
+ *
+ * @param table tabela
+ * @param capacity capacidade minima
+ */
+void ptabReserve(ProcTable *table, int capacity);
+
+/**
+ * @brief Funcao que reserva uma posicao (handle) estavel para um processo
+ *
+ * @param table tabela
+ * @param p processo
+ * @return int handle do processo
+ */
+int ptabAlloc(ProcTable *table, Process *p);
+
+/**
+ * @brief Funcao que libera a posicao de um processo
+ *
+ * @param table tabela
+ * @param handle handle do processo
+ */
+void ptabFree(ProcTable *table, int handle);
+
+/**
+ * @brief Funcao que calcula as somas acumuladas dos tickets das posicoes com um status
+ *
+ * Usa o kernel vetorizado; prefix deve ter espaco para table->size posicoes.
+ *
+ * @param table tabela
+ * @param status status
+ * @param prefix saida com as somas acumuladas
+ * @return int64_t soma total
+ */
+int64_t ptabPrefixTickets(ProcTable *table, int status, int64_t *prefix);
+
+#endif
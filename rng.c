@@ -0,0 +1,124 @@
+#include "rng.h"
+
+/**
+ * @brief Funcao que rotaciona um numero de 64 bits para a esquerda
+ *
+ * @param x numero
+ * @param k quantidade de bits
+ * @return uint64_t numero rotacionado
+ */
+static inline uint64_t rngRotl(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * @brief Funcao que inicializa o estado do gerador a partir de uma semente (via splitmix64)
+ *
+ * @param rng gerador
+ * @param seed semente
+ */
+void rngSeed(Rng *rng, uint64_t seed)
+{
+	uint64_t z;
+	int i;
+
+	for (i = 0; i < 4; i++) // splitmix64 espalha a semente pelos 256 bits do estado
+	{
+		z = (seed += 0x9e3779b97f4a7c15ULL);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		rng->s[i] = z ^ (z >> 31);
+	}
+}
+
+/**
+ * @brief Funcao que retorna o proximo numero de 64 bits do gerador (xoshiro256++)
+ *
+ * @param rng gerador
+ * @return uint64_t numero aleatorio
+ */
+uint64_t rngNext(Rng *rng)
+{
+	uint64_t *s = rng->s;
+	uint64_t result = rngRotl(s[0] + s[3], 23) + s[0];
+	uint64_t t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rngRotl(s[3], 45);
+
+	return result;
+}
+
+/**
+ * @brief Funcao que sorteia um numero sem vies entre 0 e bound - 1 (metodo de Lemire)
+ *
+ * Multiplica por bound e usa a parte alta do produto de 128 bits; so repete o
+ * sorteio na pequena faixa que causaria vies, sem divisao no caso comum.
+ *
+ * @param rng gerador
+ * @param bound limite superior (exclusivo), maior que zero
+ * @return uint64_t numero sorteado
+ */
+uint64_t rngBounded(Rng *rng, uint64_t bound)
+{
+	unsigned __int128 m = (unsigned __int128)rngNext(rng) * bound;
+	uint64_t low = (uint64_t)m, threshold;
+
+	if (low < bound)
+	{
+		threshold = -bound % bound; // (2^64 - bound) mod bound
+		while (low < threshold)
+		{
+			m = (unsigned __int128)rngNext(rng) * bound;
+			low = (uint64_t)m;
+		}
+	}
+	return (uint64_t)(m >> 64);
+}
+
+/**
+ * @brief Funcao que sorteia um numero real uniforme em [0, 1) com 53 bits de precisao
+ *
+ * @param rng gerador
+ * @return double numero sorteado
+ */
+double rngDouble(Rng *rng)
+{
+	return (rngNext(rng) >> 11) * 0x1.0p-53;
+}
+
+/**
+ * @brief Funcao que avanca o gerador 2^128 passos, criando uma sequencia independente
+ *
+ * @param rng gerador
+ */
+void rngJump(Rng *rng)
+{
+	static const uint64_t jump[] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+									0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+	uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	int i, b;
+
+	for (i = 0; i < 4; i++)
+		for (b = 0; b < 64; b++)
+		{
+			if (jump[i] & (1ULL << b))
+			{
+				s0 ^= rng->s[0];
+				s1 ^= rng->s[1];
+				s2 ^= rng->s[2];
+				s3 ^= rng->s[3];
+			}
+			rngNext(rng);
+		}
+
+	rng->s[0] = s0;
+	rng->s[1] = s1;
+	rng->s[2] = s2;
+	rng->s[3] = s3;
+}
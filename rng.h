@@ -0,0 +1,55 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+typedef struct rng
+{
+        uint64_t s[4]; // estado do xoshiro256++
+} Rng;
+
+/**
+ * @brief Funcao que inicializa o estado do gerador a partir de uma semente (via splitmix64)
+ *
+ * A mesma semente sempre produz a mesma sequencia.
+ *
+ * @param rng gerador
+ * @param seed semente
+ */
+void rngSeed(Rng *rng, uint64_t seed);
+
+/**
+ * @brief Funcao que retorna o proximo numero de 64 bits do gerador (xoshiro256++)
+ *
+ * @param rng gerador
+ * @return uint64_t numero aleatorio
+ */
+uint64_t rngNext(Rng *rng);
+
+/**
+ * @brief Funcao que sorteia um numero sem vies entre 0 e bound - 1 (metodo de Lemire)
+ *
+ * @param rng gerador
+ * @param bound limite superior (exclusivo), maior que zero
+ * @return uint64_t numero sorteado
+ */
+uint64_t rngBounded(Rng *rng, uint64_t bound);
+
+/**
+ * @brief Funcao que sorteia um numero real uniforme em [0, 1) com 53 bits de precisao
+ *
+ * @param rng gerador
+ * @return double numero sorteado
+ */
+double rngDouble(Rng *rng);
+
+/**
+ * @brief Funcao que avanca o gerador 2^128 passos, criando uma sequencia independente
+ *
+ * Usada para derivar geradores de varias CPUs ou escalonadores a partir de uma unica semente.
+ *
+ * @param rng gerador
+ */
+void rngJump(Rng *rng);
+
+#endif
@@ -1,12 +1,167 @@
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <stdint.h>
 #include "scheduler.h"
+#include "proctable.h"
+#include "trace.h"
+#include "rng.h"
 
 #define MAX_NUM_SLOT 4
+#define SCHED_DEFAULT_SEED 1994 // semente padrao do sorteio entre slots
+#define SCHED_CLAIM_ATTEMPTS 8	// sorteios por decisao quando outra CPU reivindica o vencedor antes
 
 // Slots de registro de escalonadores
 SchedInfo *sched_slots[MAX_NUM_SLOT];
 
+// Processo em execucao em cada CPU
+Process *sched_running[SCHED_MAX_CPUS];
+int sched_num_cpus = 1;
+
+// Medicao da latencia das decisoes
+int sched_latency_tracking = 1;
+
+// Escalonamento hierarquico: sorteio do slot pela sua cota e, dentro dele, decisao do algoritmo
+int sched_hierarchical = 0;
+int64_t sched_slot_tickets[MAX_NUM_SLOT]; // cota de cada slot registrado
+Rng sched_rng[SCHED_MAX_CPUS];			  // gerador do sorteio entre slots de cada CPU
+
+// Copia dos contadores usada pela thread atual (-1 ate a primeira contagem)
+__thread int sched_stats_shard = -1;
+int sched_stats_next = 0; // proxima copia a ser entregue
+
+/**
+ * @brief Funcao que retorna o tempo atual em nanossegundos, ou 0 com a medicao desligada
+ *
+ * @return long long tempo
+ */
+static long long schedNow(void)
+{
+	struct timespec ts;
+	if (!sched_latency_tracking)
+		return 0;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Funcao que retorna a faixa do histograma de um valor
+ *
+ * Valores menores que 2^SCHED_HIST_SUB_BITS tem faixa propria; os demais usam
+ * o expoente e os SCHED_HIST_SUB_BITS bits seguintes ao mais significativo.
+ *
+ * @param v valor
+ * @return int faixa
+ */
+static int schedHistIndex(unsigned long long v)
+{
+	int e, index;
+
+	if (v < (1ULL << SCHED_HIST_SUB_BITS))
+		return (int)v;
+	e = 63 - __builtin_clzll(v); // posicao do bit mais significativo
+	index = ((e - SCHED_HIST_SUB_BITS + 1) << SCHED_HIST_SUB_BITS) +
+			(int)((v >> (e - SCHED_HIST_SUB_BITS)) & ((1 << SCHED_HIST_SUB_BITS) - 1));
+	return index < SCHED_HIST_BUCKETS ? index : SCHED_HIST_BUCKETS - 1;
+}
+
+/**
+ * @brief Funcao que retorna o maior valor de uma faixa do histograma
+ *
+ * @param index faixa
+ * @return long long maior valor
+ */
+static long long schedHistUpper(int index)
+{
+	int block = index >> SCHED_HIST_SUB_BITS, sub = index & ((1 << SCHED_HIST_SUB_BITS) - 1);
+	int shift = block - 1; // expoente menos SCHED_HIST_SUB_BITS
+
+	if (block == 0)
+		return index;
+	return ((long long)((1 << SCHED_HIST_SUB_BITS) + sub + 1) << shift) - 1;
+}
+
+/**
+ * @brief Funcao que contabiliza decisoes nos contadores do escalonador
+ *
+ * Um passo que escolhe varios processos de uma vez entra no histograma como
+ * "wanted" amostras do tempo medio por decisao.
+ *
+ * @param sched escalonador
+ * @param start inicio do passo (schedNow)
+ * @param chosen processos escolhidos
+ * @param wanted processos pedidos
+ */
+static void schedAccount(SchedInfo *sched, long long start, int chosen, int wanted)
+{
+	SchedStats *stats = SCHED_STATS(sched);
+	long long elapsed;
+
+	stats->decisions += wanted;
+	stats->failed_draws += wanted - chosen;
+	if (start == 0)
+		return;
+	elapsed = schedNow() - start;
+	stats->latency_sum += elapsed;
+	elapsed /= wanted; // por decisao
+	stats->latency[schedHistIndex(elapsed)] += wanted;
+	if (elapsed > stats->latency_max)
+		stats->latency_max = elapsed;
+}
+
+/**
+ * @brief Funcao que pede a decisao de escalonamento ao algoritmo de um slot
+ *
+ * @param sched algoritmo
+ * @param plist lista de processos
+ * @param cpu numero da CPU
+ * @return Process* processo escolhido ou NULL, caso nao haja processo pronto
+ */
+static Process *schedSlotPick(SchedInfo *sched, Process *plist, int cpu)
+{
+	if (sched->scheduleCpuFn)
+		return sched->scheduleCpuFn(plist, cpu);
+	return sched->scheduleFn(plist);
+}
+
+/**
+ * @brief Funcao que sorteia um slot pela sua cota e pede a decisao ao seu algoritmo
+ *
+ * O sorteio do slot percorre uma copia das cotas (no maximo MAX_NUM_SLOT), entao
+ * CPUs decidindo ao mesmo tempo nao alteram estado compartilhado; a decisao
+ * dentro do slot fica com o indice do proprio algoritmo. Um slot sem processo
+ * pronto sai do sorteio ate o fim desta decisao.
+ *
+ * @param plist lista de processos
+ * @param cpu numero da CPU
+ * @param chosen algoritmo da ultima tentativa (NULL, caso nenhum slot tenha cota)
+ * @return Process* processo escolhido ou NULL, caso nenhum slot tenha processo pronto
+ */
+static Process *schedPickHierarchical(Process *plist, int cpu, SchedInfo **chosen)
+{
+	int64_t share[MAX_NUM_SLOT], total = 0, drawn;
+	Process *newp = NULL;
+	int slot;
+
+	for (slot = 0; slot < MAX_NUM_SLOT; slot++) // copia das cotas desta decisao
+		total += share[slot] = __atomic_load_n(&sched_slot_tickets[slot], __ATOMIC_RELAXED);
+
+	while (newp == NULL && total > 0)
+	{
+		drawn = (int64_t)rngBounded(&sched_rng[cpu], (uint64_t)total);
+		for (slot = 0; drawn >= share[slot]; slot++) // slot dono do bilhete
+			drawn -= share[slot];
+		if ((*chosen = schedGetSchedInfo(slot)) != NULL)
+			newp = schedSlotPick(*chosen, plist, cpu);
+		if (newp == NULL) // sem processo pronto, sai do sorteio
+		{
+			total -= share[slot];
+			share[slot] = 0;
+		}
+	}
+	return newp;
+}
+
 /**
  * @brief Funcao para inicializar as informacoes sobre escalonadores
  *
@@ -17,6 +172,11 @@ void schedInitSchedInfo(void)
 	// Inicializar slots de registro de escaloandores
 	for (i = 0; i < MAX_NUM_SLOT; i++)
 		sched_slots[i] = NULL;
+
+	// cotas do sorteio entre slots
+	for (i = 0; i < MAX_NUM_SLOT; i++)
+		sched_slot_tickets[i] = 0;
+	schedSetSeed(SCHED_DEFAULT_SEED);
 }
 
 /**
@@ -27,8 +187,8 @@ void schedInitSchedInfo(void)
  */
 SchedInfo *schedGetSchedInfo(int slot)
 {
-	if (slot >= 0 && slot <= MAX_NUM_SLOT)
-		return sched_slots[slot];
+	if (slot >= 0 && slot < MAX_NUM_SLOT)
+		return __atomic_load_n(&sched_slots[slot], __ATOMIC_ACQUIRE);
 	else
 		return NULL;
 }
@@ -40,8 +200,8 @@ SchedInfo *schedGetSchedInfo(int slot)
  */
 void schedNotifyProcStatusChange(Process *p)
 {
-	int slot = processGetSchedSlot(p);		// slot do processo
-	SchedInfo *sched = sched_slots[slot];	// realoca o ponteiro
+	int slot = processGetSchedSlot(p);			// slot do processo
+	SchedInfo *sched = schedGetSchedInfo(slot); // realoca o ponteiro
 	if (sched != NULL)						// se eh valido
 		sched->notifyProcStatusChangeFn(p); // notifica
 }
@@ -54,29 +214,408 @@ void schedNotifyProcStatusChange(Process *p)
  */
 Process *schedSchedule(Process *plist)
 {
-	Process *newp, *oldp; // controle
+	return schedScheduleCpu(plist, 0); // decisao para a primeira CPU
+}
 
-	// se tiver algum processo em execucao, colocar como pronto
-	if (oldp = processGetByStatus(plist, PROC_RUNNING))
+/**
+ * @brief Funcao que aciona o escalonador para uma CPU especifica
+ *
+ * @param plist processo
+ * @param cpu numero da CPU
+ * @return Process* ponteiro para o processo escolhido
+ */
+Process *schedScheduleCpu(Process *plist, int cpu)
+{
+	Process *newp = NULL, *oldp; // controle
+	SchedInfo *chosen = NULL;	 // algoritmo que decidiu
+	long long start;
+	int attempt;
+
+	if (cpu < 0 || cpu >= sched_num_cpus) // CPU nao escalonada
+		return NULL;
+	processReadBegin(cpu); // processos sorteados nao sao liberados ate o fim da decisao
+	oldp = __atomic_exchange_n(&sched_running[cpu], NULL, __ATOMIC_ACQ_REL);
+
+	// se a CPU tiver um processo em execucao, colocar como pronto (outra thread pode te-lo bloqueado)
+	if (oldp)
+		processCompareAndSetStatus(oldp, PROC_RUNNING, PROC_READY);
+
+	start = schedNow();
+	for (attempt = 0; attempt < SCHED_CLAIM_ATTEMPTS; attempt++)
 	{
-		processSetStatus(oldp, PROC_READY);
-	}
+		if (sched_hierarchical) // sorteio do slot e decisao do seu algoritmo
+			newp = schedPickHierarchical(plist, cpu, &chosen);
+		else if ((chosen = schedGetSchedInfo(0)) != NULL) // decisao ao algoritmo registrado no primeiro slot
+			newp = schedSlotPick(chosen, plist, cpu);
 
-	// decisao de escalonamento ao algoritmo registrado no primeiro slot
-	if (sched_slots[0] == NULL)
+		// Colocar processo escolhido como RUNNING, se nenhuma outra CPU o reivindicou antes
+		if (newp == NULL || processCompareAndSetStatus(newp, PROC_READY, PROC_RUNNING) >= 0)
+			break;
+		newp = NULL;
+	}
+	if (chosen == NULL) // nenhum algoritmo registrado
+	{
+		processReadEnd(cpu);
 		return NULL;
-	newp = sched_slots[0]->scheduleFn(plist);
+	}
+	schedAccount(chosen, start, newp != NULL, 1);
 
-	// Colocar processo escolhido como RUNNING
 	if (newp)
 	{
-		processSetStatus(newp, PROC_RUNNING);
 		processAddCpuUsage(newp, 1);
+		processAddCpuTime(newp, SCHED_QUANTUM_UNITS); // quantum inteiro, ate schedYield devolver o resto
+		__atomic_store_n(&sched_running[cpu], newp, __ATOMIC_RELEASE);
 	}
+	TRACE(TRACE_SCHED, cpu, newp ? processGetPid(newp) : -1, oldp ? processGetPid(oldp) : -1, 0);
+	processReadEnd(cpu);
 
 	return newp; // retornar
 }
 
+/**
+ * @brief Funcao que escalona as m primeiras CPUs em um unico passo
+ *
+ * @param plist processo
+ * @param out saida com o processo de cada CPU (NULL quando ociosa)
+ * @param m quantidade de CPUs
+ * @return int quantidade de processos escolhidos
+ */
+int schedScheduleMany(Process *plist, Process **out, int m)
+{
+	Process *old[SCHED_MAX_CPUS]; // processos que estavam nas CPUs
+	SchedInfo *sched = schedGetSchedInfo(0);
+	long long start;
+	int i, j, n;
+
+	if (m > sched_num_cpus)
+		m = sched_num_cpus;
+	if ((sched == NULL && !sched_hierarchical) || m <= 0)
+		return 0;
+	if (sched_hierarchical || sched->scheduleManyFn == NULL) // sem sorteio em lote, uma decisao por CPU
+	{
+		for (i = n = 0; i < m; i++) // posicional: out[i] fica NULL quando a CPU i fica ociosa
+			if ((out[i] = schedScheduleCpu(plist, i)) != NULL)
+				n++;
+		return n;
+	}
+
+	// todos os processos das CPUs voltam a ficar prontos antes do sorteio
+	processReadBegin(SCHED_BATCH_READER);
+	for (i = 0; i < m; i++)
+	{
+		old[i] = __atomic_exchange_n(&sched_running[i], NULL, __ATOMIC_ACQ_REL);
+		if (old[i])
+			processCompareAndSetStatus(old[i], PROC_RUNNING, PROC_READY);
+	}
+
+	start = schedNow();
+	n = sched->scheduleManyFn(plist, out, m);
+
+	// Colocar processos escolhidos como RUNNING, um por CPU (os ja reivindicados por outra thread ficam de fora)
+	for (i = j = 0; i < n; i++)
+	{
+		if (processCompareAndSetStatus(out[i], PROC_READY, PROC_RUNNING) < 0)
+			continue;
+		processAddCpuUsage(out[i], 1);
+		processAddCpuTime(out[i], SCHED_QUANTUM_UNITS);
+		out[j] = out[i];
+		__atomic_store_n(&sched_running[j], out[j], __ATOMIC_RELEASE);
+		j++;
+	}
+	schedAccount(sched, start, j, m); // vencedores reivindicados por outra CPU contam como sorteios sem vencedor
+	for (n = j; j < m; j++) // CPUs sem processo ficam ociosas
+		out[j] = NULL;
+	for (i = 0; i < m; i++)
+		TRACE(TRACE_SCHED, i, i < n ? processGetPid(out[i]) : -1, old[i] ? processGetPid(old[i]) : -1, 0);
+	processReadEnd(SCHED_BATCH_READER);
+
+	return n;
+}
+
+/**
+ * @brief Funcao que define quantas CPUs sao escalonadas, repassando a quantidade aos algoritmos registrados
+ *
+ * @param n quantidade de CPUs
+ * @return int quantidade definida e -1, caso seja invalida ou algum algoritmo a recuse
+ */
+int schedSetNumCpus(int n)
+{
+	SchedInfo *sched;
+	int i, j;
+
+	if (n < 1 || n > SCHED_MAX_CPUS)
+		return -1;
+	for (i = 0; i < MAX_NUM_SLOT; i++) // filas dos algoritmos acompanham as CPUs
+	{
+		sched = schedGetSchedInfo(i);
+		if (sched == NULL || sched->setNumCpusFn == NULL || sched->setNumCpusFn(n) >= 0)
+			continue;
+		for (j = 0; j < i; j++) // recusada, desfaz nos slots anteriores
+			if ((sched = schedGetSchedInfo(j)) != NULL && sched->setNumCpusFn != NULL)
+				sched->setNumCpusFn(sched_num_cpus);
+		return -1;
+	}
+	for (i = n; i < sched_num_cpus; i++) // CPUs removidas devolvem seus processos
+	{
+		if (sched_running[i] && processGetStatus(sched_running[i]) == PROC_RUNNING)
+			processSetStatus(sched_running[i], PROC_READY);
+		sched_running[i] = NULL;
+	}
+	sched_num_cpus = n;
+	return n;
+}
+
+/**
+ * @brief Funcao que retorna quantas CPUs sao escalonadas
+ *
+ * @return int quantidade de CPUs
+ */
+int schedGetNumCpus(void)
+{
+	return sched_num_cpus;
+}
+
+/**
+ * @brief Funcao que retorna o processo em execucao em uma CPU, em O(1)
+ *
+ * @param cpu numero da CPU
+ * @return Process* processo ou NULL, caso a CPU esteja livre
+ */
+Process *schedGetRunning(int cpu)
+{
+	if (cpu < 0 || cpu >= sched_num_cpus)
+		return NULL;
+	return __atomic_load_n(&sched_running[cpu], __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Funcao que registra que o processo em execucao devolveu a CPU antes do fim do quantum
+ *
+ * @param p processo em execucao
+ * @param used fracao usada do quantum, entre 0 e SCHED_QUANTUM_UNITS
+ * @return int 1 caso o processo esteja em execucao e -1, caso contrario
+ */
+int schedYield(Process *p, int used)
+{
+	SchedInfo *sched = schedGetSchedInfo(processGetSchedSlot(p));
+
+	if (used < 0 || used > SCHED_QUANTUM_UNITS)
+		return -1;
+	processLockProc(p); // a compensacao nao se mistura com outra troca de status
+	if (processGetStatus(p) != PROC_RUNNING)
+	{
+		processUnlockProc(p);
+		return -1;
+	}
+	processAddCpuTime(p, used - SCHED_QUANTUM_UNITS); // devolve o que nao foi usado
+	if (sched != NULL)
+	{
+		SCHED_STATS(sched)->yields++;
+		if (sched->chargeQuantumFn)
+			sched->chargeQuantumFn(p, used);
+	}
+	processUnlockProc(p);
+	return 1;
+}
+
+/**
+ * @brief Funcao que libera a CPU ocupada por um processo que deixou de executar
+ *
+ * @param p processo
+ */
+void schedReleaseCpu(Process *p)
+{
+	int i;
+
+	for (i = 0; i < sched_num_cpus; i++) // a CPU pode estar trocando de processo ao mesmo tempo
+	{
+		Process *expected = p;
+		if (__atomic_load_n(&sched_running[i], __ATOMIC_RELAXED) == p)
+			__atomic_compare_exchange_n(&sched_running[i], &expected, NULL, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+	}
+}
+
+/**
+ * @brief Funcao que avisa o escalonador que um processo sera destruido, liberando sua CPU
+ *
+ * @param p processo
+ */
+void schedNotifyProcDestroy(Process *p)
+{
+	if (processGetStatus(p) == PROC_RUNNING) // so processos em execucao ocupam CPU
+		schedReleaseCpu(p);
+}
+
+/**
+ * @brief Funcao que copia os contadores de um escalonador
+ *
+ * @param slot slot
+ * @param out copia dos contadores
+ * @return int 1 caso o slot seja valido e -1, caso contrario
+ */
+int schedGetStats(int slot, SchedStats *out)
+{
+	SchedInfo *sched = schedGetSchedInfo(slot);
+	SchedStats *shard;
+	int i, b;
+
+	if (sched == NULL)
+		return -1;
+	*out = sched->stats[0];
+	for (i = 1; i < SCHED_STATS_SHARDS; i++) // soma as copias de todas as threads
+	{
+		shard = &sched->stats[i];
+		out->decisions += shard->decisions;
+		out->failed_draws += shard->failed_draws;
+		out->rebuilds += shard->rebuilds;
+		out->scanned += shard->scanned;
+		out->transfers += shard->transfers;
+		out->yields += shard->yields;
+		out->compensations += shard->compensations;
+		for (b = 0; b < SCHED_HIST_BUCKETS; b++)
+			out->latency[b] += shard->latency[b];
+		out->latency_sum += shard->latency_sum;
+		if (shard->latency_max > out->latency_max)
+			out->latency_max = shard->latency_max;
+	}
+	return 1;
+}
+
+/**
+ * @brief Funcao que zera os contadores de um escalonador
+ *
+ * @param slot slot
+ * @return int 1 caso o slot seja valido e -1, caso contrario
+ */
+int schedResetStats(int slot)
+{
+	SchedInfo *sched = schedGetSchedInfo(slot);
+	if (sched == NULL)
+		return -1;
+	memset(sched->stats, 0, sizeof(sched->stats));
+	return 1;
+}
+
+/**
+ * @brief Funcao que retorna um percentil do histograma de latencia
+ *
+ * @param stats contadores
+ * @param q percentil entre 0 e 1 (por exemplo 0.99)
+ * @return long long latencia em ns (limite superior da faixa) ou 0, caso nao haja decisoes medidas
+ */
+long long schedStatsPercentile(const SchedStats *stats, double q)
+{
+	long total = 0, seen = 0, target;
+	int i;
+
+	for (i = 0; i < SCHED_HIST_BUCKETS; i++)
+		total += stats->latency[i];
+	if (total == 0)
+		return 0;
+
+	target = (long)(q * total); // quantidade de amostras abaixo do percentil
+	if (target >= total)
+		target = total - 1;
+	for (i = 0; i < SCHED_HIST_BUCKETS; i++)
+	{
+		seen += stats->latency[i];
+		if (seen > target)
+			break;
+	}
+	return schedHistUpper(i) < stats->latency_max ? schedHistUpper(i) : stats->latency_max;
+}
+
+/**
+ * @brief Funcao que liga ou desliga a medicao de latencia das decisoes (ligada por padrao)
+ *
+ * @param enabled 1 para medir e 0, caso contrario
+ */
+void schedSetLatencyTracking(int enabled)
+{
+	sched_latency_tracking = enabled;
+}
+
+// cabecalho da secao do escalonador no instantaneo
+typedef struct sched_snap_info
+{
+	char names[MAX_NUM_SLOT][8];		// algoritmo de cada slot (vazio se livre)
+	int64_t slot_tickets[MAX_NUM_SLOT]; // cota de cada slot
+	int32_t num_cpus;					// CPUs escalonadas
+	int32_t hierarchical;				// sorteio entre slots ligado
+} SchedSnapInfo;
+
+/**
+ * @brief Funcao que grava no instantaneo as CPUs, os slots registrados e os geradores do sorteio entre slots
+ *
+ * @param s instantaneo em gravacao
+ */
+void schedSave(Snapshot *s)
+{
+	SchedSnapInfo info;
+	SchedInfo *sched;
+	Process *p;
+	int running[SCHED_MAX_CPUS], i;
+
+	memset(&info, 0, sizeof(info));
+	for (i = 0; i < MAX_NUM_SLOT; i++)
+	{
+		if ((sched = schedGetSchedInfo(i)) != NULL)
+			memcpy(info.names[i], sched->name, MAX_NAME_LEN);
+		info.slot_tickets[i] = sched_slot_tickets[i];
+	}
+	info.num_cpus = sched_num_cpus;
+	info.hierarchical = sched_hierarchical;
+	for (i = 0; i < SCHED_MAX_CPUS; i++) // processo de cada CPU pelo handle
+		running[i] = (p = schedGetRunning(i)) != NULL ? processGetHandle(p) : -1;
+
+	snapBeginSection(s, SNAP_SEC_SCHED);
+	snapWrite(s, &info, sizeof(info));
+	snapWrite(s, sched_rng, sizeof(sched_rng));
+	snapWrite(s, running, sizeof(running));
+}
+
+/**
+ * @brief Funcao que restaura o estado gravado por schedSave, depois da tabela de processos
+ *
+ * @param s instantaneo aberto
+ * @return int 1 caso o estado seja restaurado e 0, caso contrario
+ */
+int schedLoad(Snapshot *s)
+{
+	ProcTable *table = processGetTable();
+	const SchedSnapInfo *info;
+	const Rng *rng;
+	const int *running;
+	SchedInfo *sched;
+	int i;
+
+	if (!snapSeek(s, SNAP_SEC_SCHED) || (info = snapRead(s, sizeof(SchedSnapInfo))) == NULL)
+		return 0;
+	rng = snapRead(s, sizeof(sched_rng));
+	running = snapRead(s, SCHED_MAX_CPUS * sizeof(int));
+	if (s->error || info->num_cpus < 1 || info->num_cpus > SCHED_MAX_CPUS)
+		return 0;
+	for (i = 0; i < MAX_NUM_SLOT; i++) // mesmos algoritmos nos mesmos slots
+	{
+		sched = schedGetSchedInfo(i);
+		if (sched ? strncmp(info->names[i], sched->name, MAX_NAME_LEN) != 0 : info->names[i][0] != '\0')
+			return 0;
+	}
+	for (i = 0; i < SCHED_MAX_CPUS; i++) // so processos restaurados e em execucao
+		if (running[i] >= table->size ||
+			(running[i] >= 0 && (i >= info->num_cpus || table->status[running[i]] != PROC_RUNNING)))
+			return 0;
+
+	sched_num_cpus = info->num_cpus;
+	sched_hierarchical = info->hierarchical;
+	for (i = 0; i < MAX_NUM_SLOT; i++)
+		sched_slot_tickets[i] = info->slot_tickets[i];
+	memcpy(sched_rng, rng, sizeof(sched_rng));
+	for (i = 0; i < SCHED_MAX_CPUS; i++)
+		sched_running[i] = running[i] >= 0 ? table->proc[running[i]] : NULL;
+	return 1;
+}
+
 /**
  * @brief Funcao que associa um processo a um algoritmo de escalonamento especifico
  *
@@ -89,13 +628,13 @@ int schedSetScheduler(Process *p, void *params, int slot)
 {
 	int oldslot;
 
-	if (sched_slots[slot] == NULL) // verifica se slot eh valido
+	if (schedGetSchedInfo(slot) == NULL) // verifica se slot eh valido
 		return -1;
 
 	oldslot = processGetSchedSlot(p);
 
-	if (oldslot >= 0) // libera parametros de escalonamento antigos
-		sched_slots[oldslot]->releaseParamsFn(p);
+	if (oldslot >= 0 && schedGetSchedInfo(oldslot)) // libera parametros de escalonamento antigos
+		schedGetSchedInfo(oldslot)->releaseParamsFn(p);
 
 	processSetSchedSlot(p, slot); // associa processo ao slot informado
 
@@ -111,16 +650,24 @@ int schedSetScheduler(Process *p, void *params, int slot)
  */
 int schedRegisterScheduler(SchedInfo *sched_info)
 {
+	SchedInfo *expected;
 	int i;
 
-	// laco para encontrar slot livre
-	for (i = 0; i < MAX_NUM_SLOT && sched_slots[i] != NULL; i++)
-		;
+	memset(sched_info->stats, 0, sizeof(sched_info->stats)); // antes de ficar visivel as outras threads
+	if (sched_info->setNumCpusFn != NULL) // algoritmo registrado depois de schedSetNumCpus
+		sched_info->setNumCpusFn(sched_num_cpus);
+
+	// laco para encontrar slot livre, ocupando-o sem trava
+	for (i = 0; i < MAX_NUM_SLOT; i++)
+	{
+		expected = NULL;
+		if (__atomic_compare_exchange_n(&sched_slots[i], &expected, sched_info, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			break;
+	}
 	if (i == MAX_NUM_SLOT)
 		return -1;
 
-	sched_slots[i] = sched_info; // atribuir ao slot a estrutura com informacoes do novo escalonador
-
+	__atomic_store_n(&sched_slot_tickets[i], SCHED_DEFAULT_SLOT_TICKETS, __ATOMIC_RELAXED); // cota igual entre os slots
 	return i;
 }
 
@@ -133,9 +680,61 @@ int schedRegisterScheduler(SchedInfo *sched_info)
  */
 int schedUnregisterScheduler(int slot, char *name)
 {
-	if (!sched_slots[slot] || strcmp(name, sched_slots[slot]->name)) // verifica se slot informado eh valido
+	SchedInfo *sched = schedGetSchedInfo(slot);
+
+	if (!sched || strcmp(name, sched->name)) // verifica se slot informado eh valido
 		return -1;
 
-	sched_slots[slot] = NULL; // forca valor de slot para NULL
+	__atomic_store_n(&sched_slot_tickets[slot], 0, __ATOMIC_RELAXED); // sai do sorteio entre slots
+	if (!__atomic_compare_exchange_n(&sched_slots[slot], &sched, NULL, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+		return -1; // removido por outra thread
 	return slot;
 }
+
+/**
+ * @brief Funcao que liga ou desliga o escalonamento hierarquico entre os slots
+ *
+ * @param enabled 1 para sortear o slot pela cota e 0 para usar so o primeiro slot
+ */
+void schedSetHierarchical(int enabled)
+{
+	sched_hierarchical = enabled;
+}
+
+/**
+ * @brief Funcao que define a cota de um slot no sorteio hierarquico
+ *
+ * @param slot slot
+ * @param tickets cota (0 tira o slot do sorteio)
+ * @return int 1 caso o slot seja valido e -1, caso contrario
+ */
+int schedSetSlotTickets(int slot, int64_t tickets)
+{
+	if (!schedGetSchedInfo(slot) || tickets < 0 || tickets > INT64_MAX / MAX_NUM_SLOT) // a soma das cotas cabe em 64 bits
+		return -1;
+	__atomic_store_n(&sched_slot_tickets[slot], tickets, __ATOMIC_RELAXED);
+	return 1;
+}
+
+/**
+ * @brief Funcao que define a semente do sorteio entre slots
+ *
+ * @param seed semente
+ */
+void schedSetSeed(uint64_t seed)
+{
+	int i;
+	for (i = 0; i < SCHED_MAX_CPUS; i++) // uma sequencia por CPU
+		rngSeed(&sched_rng[i], seed + i);
+}
+
+/**
+ * @brief Funcao que entrega a thread atual a sua copia dos contadores
+ *
+ * @return int copia da thread
+ */
+int schedStatsShard(void)
+{
+	sched_stats_shard = __atomic_fetch_add(&sched_stats_next, 1, __ATOMIC_RELAXED) % SCHED_STATS_SHARDS;
+	return sched_stats_shard;
+}
@@ -4,6 +4,32 @@
 #include "process.h"
 
 #define MAX_NAME_LEN 4
+#define SCHED_MAX_CPUS 64 // quantidade maxima de CPUs escalonadas
+#define SCHED_DEFAULT_SLOT_TICKETS 100 // cota de um slot recem-registrado no sorteio hierarquico
+#define SCHED_QUANTUM_UNITS 1000 // fracoes de um quantum (milesimos) na contabilidade do tempo de CPU
+#define SCHED_STATS_SHARDS 64 // copias dos contadores, uma por thread, somadas por schedGetStats
+#define SCHED_BATCH_READER SCHED_MAX_CPUS // leitor de processReadBegin do sorteio em lote (depois dos das CPUs)
+
+// process.h nao inclui este cabecalho: os leitores por epocas sao conferidos aqui
+_Static_assert(PROC_MAX_READERS > SCHED_BATCH_READER, "PROC_MAX_READERS deve cobrir as CPUs e o sorteio em lote");
+
+// histograma de latencia no estilo HDR: cada potencia de 2 dividida em 2^SCHED_HIST_SUB_BITS faixas
+#define SCHED_HIST_SUB_BITS 3                                                // erro relativo de ate 12,5%
+#define SCHED_HIST_BUCKETS ((40 - SCHED_HIST_SUB_BITS + 2) << SCHED_HIST_SUB_BITS) // ate 2^41 ns
+
+typedef struct sched_stats
+{
+        long decisions;                     // decisoes de escalonamento
+        long failed_draws;                  // decisoes sem processo escolhido
+        long rebuilds;                      // reconstrucoes completas do indice de tickets
+        long scanned;                       // elementos percorridos nos sorteios e reconstrucoes
+        long transfers;                     // transferencias de tickets
+        long yields;                        // quanta devolvidos antes do fim
+        long compensations;                 // concessoes de tickets de compensacao
+        long latency[SCHED_HIST_BUCKETS];   // histograma da latencia das decisoes (ns)
+        long long latency_sum;              // soma das latencias (ns)
+        long long latency_max;              // maior latencia (ns)
+} SchedStats;
 
 typedef struct sched_info
 {
@@ -11,9 +37,28 @@ typedef struct sched_info
         void (*initParamsFn)(Process *p, void *params); // inicializar os parametros de escalonamento
         void (*notifyProcStatusChangeFn)(Process *p);   // notificar sobre a mudança de estado de um processo
         Process *(*scheduleFn)(Process *plist);         // decidir qual o proximo processo a obter a CPU
+        Process *(*scheduleCpuFn)(Process *plist, int cpu); // decidir o proximo processo de uma CPU especifica (opcional)
+        int (*scheduleManyFn)(Process *plist, Process **out, int m); // sortear m processos distintos de uma vez (opcional)
+        void (*chargeQuantumFn)(Process *p, int used);  // cobrar a fracao usada do quantum (opcional)
+        int (*setNumCpusFn)(int n);                     // acompanhar a quantidade de CPUs escalonadas (opcional)
         int (*releaseParamsFn)(Process *p);             // liberar os parametros de escalonemnto
+        SchedStats stats[SCHED_STATS_SHARDS];           // contadores do algoritmo por thread (zerados no registro)
 } SchedInfo;
 
+// Copia dos contadores da thread atual (cada thread escreve so na sua, sem disputa)
+extern __thread int sched_stats_shard;
+#define SCHED_STATS(sched) (&(sched)->stats[sched_stats_shard >= 0 ? sched_stats_shard : schedStatsShard()])
+
+/**
+ * @brief Funcao que entrega a thread atual a sua copia dos contadores
+ *
+ * Com mais de SCHED_STATS_SHARDS threads as copias sao compartilhadas e as
+ * contagens passam a ser aproximadas.
+ *
+ * @return int copia da thread
+ */
+int schedStatsShard(void);
+
 /**
  * @brief Funcao para inicializar as informacoes sobre escalonadores
  *
@@ -43,6 +88,169 @@ void schedNotifyProcStatusChange(Process *p);
  */
 Process *schedSchedule(Process *plist);
 
+/**
+ * @brief Funcao que aciona o escalonador para uma CPU especifica
+ *
+ * O processo que estava executando nessa CPU volta a ficar pronto e o algoritmo
+ * do primeiro slot escolhe o proximo (por scheduleCpuFn, quando existir).
+ *
+ * @param plist processo
+ * @param cpu numero da CPU, entre 0 e schedGetNumCpus() - 1
+ * @return Process* ponteiro para o processo escolhido ou NULL, caso a CPU seja invalida
+ */
+Process *schedScheduleCpu(Process *plist, int cpu);
+
+/**
+ * @brief Funcao que escalona as m primeiras CPUs em um unico passo
+ *
+ * Os processos em execucao nessas CPUs voltam a ficar prontos e m processos
+ * distintos sao escolhidos de uma vez (por scheduleManyFn, quando existir).
+ * O processo out[i] passa a executar na CPU i; out[i] fica NULL quando a
+ * CPU i fica ociosa.
+ *
+ * @param plist processo
+ * @param out saida com o processo de cada CPU (NULL quando ociosa)
+ * @param m quantidade de CPUs
+ * @return int quantidade de processos escolhidos
+ */
+int schedScheduleMany(Process *plist, Process **out, int m);
+
+/**
+ * @brief Funcao que define quantas CPUs sao escalonadas
+ *
+ * A quantidade tambem eh repassada aos algoritmos registrados (por
+ * setNumCpusFn, quando existir), que mantem suas filas por CPU.
+ *
+ * @param n quantidade de CPUs
+ * @return int quantidade definida e -1, caso seja invalida
+ */
+int schedSetNumCpus(int n);
+
+/**
+ * @brief Funcao que retorna quantas CPUs sao escalonadas
+ *
+ * @return int quantidade de CPUs
+ */
+int schedGetNumCpus(void);
+
+/**
+ * @brief Funcao que retorna o processo em execucao em uma CPU, em O(1)
+ *
+ * @param cpu numero da CPU
+ * @return Process* processo ou NULL, caso a CPU esteja livre
+ */
+Process *schedGetRunning(int cpu);
+
+/**
+ * @brief Funcao que registra que o processo em execucao devolveu a CPU antes do fim do quantum
+ *
+ * O tempo nao usado eh devolvido a contabilidade do processo e o algoritmo do
+ * seu slot eh avisado (por chargeQuantumFn, quando existir), por exemplo para
+ * conceder tickets de compensacao. Deve ser chamada antes de bloquear o processo.
+ *
+ * @param p processo em execucao
+ * @param used fracao usada do quantum, entre 0 e SCHED_QUANTUM_UNITS
+ * @return int 1 caso o processo esteja em execucao e -1, caso contrario
+ */
+int schedYield(Process *p, int used);
+
+/**
+ * @brief Funcao que libera a CPU ocupada por um processo que deixou de executar
+ *
+ * Sem isso a CPU devolveria como pronto, na decisao seguinte, um processo que
+ * foi bloqueado, desbloqueado e reivindicado por outra CPU nesse meio tempo.
+ *
+ * @param p processo
+ */
+void schedReleaseCpu(Process *p);
+
+/**
+ * @brief Funcao que avisa o escalonador que um processo sera destruido, liberando sua CPU
+ *
+ * @param p processo
+ */
+void schedNotifyProcDestroy(Process *p);
+
+/**
+ * @brief Funcao que copia os contadores de um escalonador
+ *
+ * @param slot slot
+ * @param out copia dos contadores
+ * @return int 1 caso o slot seja valido e -1, caso contrario
+ */
+int schedGetStats(int slot, SchedStats *out);
+
+/**
+ * @brief Funcao que zera os contadores de um escalonador
+ *
+ * @param slot slot
+ * @return int 1 caso o slot seja valido e -1, caso contrario
+ */
+int schedResetStats(int slot);
+
+/**
+ * @brief Funcao que retorna um percentil do histograma de latencia
+ *
+ * @param stats contadores
+ * @param q percentil entre 0 e 1 (por exemplo 0.99)
+ * @return long long latencia em ns (limite superior da faixa) ou 0, caso nao haja decisoes medidas
+ */
+long long schedStatsPercentile(const SchedStats *stats, double q);
+
+/**
+ * @brief Funcao que liga ou desliga a medicao de latencia das decisoes (ligada por padrao)
+ *
+ * @param enabled 1 para medir e 0, caso contrario
+ */
+void schedSetLatencyTracking(int enabled);
+
+/**
+ * @brief Funcao que liga ou desliga o escalonamento hierarquico entre os slots
+ *
+ * Ligado, cada decisao sorteia um slot pela sua cota (entre os slots com processo
+ * pronto) e o algoritmo desse slot escolhe o processo; desligado, so o primeiro
+ * slot eh usado.
+ *
+ * @param enabled 1 para sortear o slot pela cota e 0 para usar so o primeiro slot
+ */
+void schedSetHierarchical(int enabled);
+
+/**
+ * @brief Funcao que define a cota de um slot no sorteio hierarquico
+ *
+ * A cota eh so gravada; cada decisao copia as cotas dos MAX_NUM_SLOT slots e
+ * sorteia o slot sobre essa copia.
+ *
+ * @param slot slot
+ * @param tickets cota (0 tira o slot do sorteio)
+ * @return int 1 caso o slot seja valido e -1, caso contrario
+ */
+int schedSetSlotTickets(int slot, int64_t tickets);
+
+/**
+ * @brief Funcao que define a semente do sorteio entre slots
+ *
+ * @param seed semente
+ */
+void schedSetSeed(uint64_t seed);
+
+/**
+ * @brief Funcao que grava no instantaneo as CPUs, os slots registrados e os geradores do sorteio entre slots
+ *
+ * @param s instantaneo em gravacao
+ */
+void schedSave(Snapshot *s);
+
+/**
+ * @brief Funcao que restaura o estado gravado por schedSave, depois da tabela de processos
+ *
+ * Os mesmos algoritmos devem estar registrados nos mesmos slots.
+ *
+ * @param s instantaneo aberto
+ * @return int 1 caso o estado seja restaurado e 0, caso contrario
+ */
+int schedLoad(Snapshot *s);
+
 /**
  * @brief Funcao que associa um processo a um algoritmo de escalonamento especifico
  *
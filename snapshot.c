@@ -0,0 +1,305 @@
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+#define SNAP_PRIME1 0x9E3779B185EBCA87ULL // constantes de mistura da soma de verificacao
+#define SNAP_PRIME2 0xC2B2AE3D27D4EB4FULL
+
+/**
+ * @brief Funcao que acumula palavras de 64 bits na soma de verificacao
+ *
+ * @param h soma atual
+ * @param data dados (tamanho multiplo de 8)
+ * @param size quantidade de bytes
+ * @return uint64_t soma atualizada
+ */
+static uint64_t snapChecksum(uint64_t h, const void *data, size_t size)
+{
+	const uint8_t *p = data;
+	uint64_t w;
+	size_t i;
+
+	for (i = 0; i + 8 <= size; i += 8)
+	{
+		memcpy(&w, p + i, 8);
+		h ^= w * SNAP_PRIME2;
+		h = ((h << 31) | (h >> 33)) * SNAP_PRIME1; // cada palavra espalha por todos os bits
+	}
+	return h;
+}
+
+/**
+ * @brief Funcao que calcula a soma de verificacao do cabecalho, com o campo da soma zerado
+ *
+ * @param header cabecalho
+ * @return uint64_t soma de verificacao
+ */
+static uint64_t snapHeaderChecksum(const SnapHeader *header)
+{
+	SnapHeader copy = *header;
+
+	copy.checksum = 0;
+	return snapChecksum(SNAP_PRIME1, &copy, sizeof(copy));
+}
+
+/**
+ * @brief Funcao que grava bytes no arquivo, contando o deslocamento
+ *
+ * @param s instantaneo
+ * @param data dados
+ * @param size quantidade de bytes
+ */
+static void snapPut(Snapshot *s, const void *data, size_t size)
+{
+	if (size > 0 && fwrite(data, 1, size, s->file) != size)
+		s->error = 1;
+	s->offset += size;
+}
+
+/**
+ * @brief Funcao que completa o arquivo com zeros ate um alinhamento
+ *
+ * @param s instantaneo
+ * @param align alinhamento
+ * @return size_t bytes acrescentados
+ */
+static size_t snapPad(Snapshot *s, size_t align)
+{
+	static const uint8_t zeros[SNAP_ALIGN];
+	size_t pad = (align - s->offset % align) % align;
+
+	snapPut(s, zeros, pad);
+	return pad;
+}
+
+/**
+ * @brief Funcao que cria um arquivo de instantaneo vazio
+ *
+ * @param s instantaneo
+ * @param path caminho do arquivo
+ * @return int 1 caso o arquivo seja criado e 0, caso contrario
+ */
+int snapCreate(Snapshot *s, const char *path)
+{
+	memset(s, 0, sizeof(*s));
+	s->file = fopen(path, "wb");
+	if (s->file == NULL)
+		return 0;
+	s->header.magic = SNAP_MAGIC;
+	s->header.version = SNAP_VERSION;
+	s->header.byte_order = SNAP_BYTE_ORDER;
+	s->header.header_size = sizeof(SnapHeader);
+	s->current = -1;
+	snapPut(s, &s->header, sizeof(s->header)); // reescrito no fim
+	return 1;
+}
+
+/**
+ * @brief Funcao que encerra a secao atual
+ *
+ * @param s instantaneo
+ */
+static void snapEndSection(Snapshot *s)
+{
+	if (s->current < 0)
+		return;
+	s->header.sections[s->current].size = s->offset - s->header.sections[s->current].offset;
+	s->current = -1;
+}
+
+/**
+ * @brief Funcao que inicia uma secao, encerrando a anterior
+ *
+ * @param s instantaneo
+ * @param id identificador da secao (SNAP_SEC_*)
+ */
+void snapBeginSection(Snapshot *s, int id)
+{
+	SnapSection *sec;
+
+	snapEndSection(s);
+	if (s->header.num_sections == SNAP_MAX_SECTIONS)
+	{
+		s->error = 1;
+		return;
+	}
+	snapPad(s, SNAP_ALIGN); // vetores da secao alinhados no arquivo mapeado
+	s->current = s->header.num_sections++;
+	sec = &s->header.sections[s->current];
+	sec->id = (uint32_t)id;
+	sec->offset = s->offset;
+	sec->checksum = SNAP_PRIME1;
+}
+
+/**
+ * @brief Funcao que grava bytes na secao atual, completando ate multiplo de 8
+ *
+ * @param s instantaneo
+ * @param data dados
+ * @param size quantidade de bytes
+ */
+void snapWrite(Snapshot *s, const void *data, size_t size)
+{
+	static const uint8_t zeros[8];
+	SnapSection *sec;
+	size_t whole = size & ~(size_t)7, rest = size - whole;
+	uint8_t tail[8];
+
+	if (s->current < 0)
+	{
+		s->error = 1;
+		return;
+	}
+	sec = &s->header.sections[s->current];
+	snapPut(s, data, whole);
+	sec->checksum = snapChecksum(sec->checksum, data, whole);
+	if (rest > 0) // ultima palavra completada com zeros
+	{
+		memset(tail, 0, sizeof(tail));
+		memcpy(tail, (const uint8_t *)data + whole, rest);
+		snapPut(s, tail, rest);
+		snapPut(s, zeros, 8 - rest);
+		sec->checksum = snapChecksum(sec->checksum, tail, 8);
+	}
+}
+
+/**
+ * @brief Funcao que encerra a gravacao, completando o cabecalho
+ *
+ * @param s instantaneo
+ * @return int 1 caso o instantaneo seja gravado por completo e 0, caso contrario
+ */
+int snapFinish(Snapshot *s)
+{
+	snapEndSection(s);
+	s->header.file_size = s->offset;
+	s->header.checksum = snapHeaderChecksum(&s->header);
+	if (fseek(s->file, 0, SEEK_SET) != 0 || fwrite(&s->header, sizeof(s->header), 1, s->file) != 1)
+		s->error = 1;
+	if (fclose(s->file) != 0)
+		s->error = 1;
+	s->file = NULL;
+	return !s->error;
+}
+
+/**
+ * @brief Funcao que abre um instantaneo, mapeando o arquivo e conferindo cabecalho, tamanho e somas de verificacao
+ *
+ * @param s instantaneo
+ * @param path caminho do arquivo
+ * @return int 1 caso o instantaneo seja valido e SNAP_ERR_*, caso contrario
+ */
+int snapOpen(Snapshot *s, const char *path)
+{
+	struct stat st;
+	void *data;
+	SnapSection *sec;
+	int fd = open(path, O_RDONLY), i;
+
+	memset(s, 0, sizeof(*s));
+	s->current = -1;
+	if (fd < 0)
+		return SNAP_ERR_OPEN;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return SNAP_ERR_OPEN;
+	}
+	if ((size_t)st.st_size < sizeof(SnapHeader))
+	{
+		close(fd);
+		return SNAP_ERR_FORMAT;
+	}
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // o mapeamento continua valido
+	if (data == MAP_FAILED)
+		return SNAP_ERR_OPEN;
+	s->data = data;
+	s->size = (size_t)st.st_size;
+	memcpy(&s->header, data, sizeof(SnapHeader));
+
+	if (s->header.magic != SNAP_MAGIC || s->header.version != SNAP_VERSION ||
+		s->header.byte_order != SNAP_BYTE_ORDER || s->header.header_size != sizeof(SnapHeader))
+	{
+		snapClose(s);
+		return SNAP_ERR_FORMAT;
+	}
+	if (s->header.checksum != snapHeaderChecksum(&s->header) || s->header.file_size != s->size ||
+		s->header.num_sections > SNAP_MAX_SECTIONS)
+	{
+		snapClose(s);
+		return SNAP_ERR_CORRUPT;
+	}
+
+	madvise(data, s->size, MADV_SEQUENTIAL); // somas de verificacao e copias do inicio ao fim
+	for (i = 0; i < s->header.num_sections; i++) // toda secao eh conferida antes de qualquer leitura
+	{
+		sec = &s->header.sections[i];
+		if (sec->offset > s->size || sec->size > s->size - sec->offset || sec->size % 8 != 0 ||
+			snapChecksum(SNAP_PRIME1, s->data + sec->offset, sec->size) != sec->checksum)
+		{
+			snapClose(s);
+			return SNAP_ERR_CORRUPT;
+		}
+	}
+	return 1;
+}
+
+/**
+ * @brief Funcao que posiciona a leitura no inicio de uma secao
+ *
+ * @param s instantaneo
+ * @param id identificador da secao
+ * @return int 1 caso a secao exista e 0, caso contrario
+ */
+int snapSeek(Snapshot *s, int id)
+{
+	int i;
+
+	for (i = 0; i < s->header.num_sections; i++)
+		if (s->header.sections[i].id == (uint32_t)id)
+		{
+			s->pos = s->data + s->header.sections[i].offset;
+			s->end = s->pos + s->header.sections[i].size;
+			return 1;
+		}
+	s->pos = s->end = NULL;
+	return 0;
+}
+
+/**
+ * @brief Funcao que le bytes da secao atual, direto do arquivo mapeado
+ *
+ * @param s instantaneo
+ * @param size quantidade de bytes (o mesmo tamanho passado a snapWrite)
+ * @return const void* dados ou NULL, caso a secao termine antes
+ */
+const void *snapRead(Snapshot *s, size_t size)
+{
+	const uint8_t *p = s->pos;
+	size_t padded = (size + 7) & ~(size_t)7;
+
+	if (p == NULL || padded < size || padded > (size_t)(s->end - p))
+	{
+		s->error = 1;
+		return NULL;
+	}
+	s->pos += padded;
+	return p;
+}
+
+/**
+ * @brief Funcao que fecha um instantaneo aberto por snapOpen
+ *
+ * @param s instantaneo
+ */
+void snapClose(Snapshot *s)
+{
+	if (s->data != NULL)
+		munmap((void *)s->data, s->size);
+	s->data = s->pos = s->end = NULL;
+	s->size = 0;
+}
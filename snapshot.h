@@ -0,0 +1,140 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Instantaneo do estado do escalonador: tabela de processos, filas com os
+ * indices de tickets, processos em execucao, geradores e roda de tempo, em um
+ * unico arquivo com secoes. Cada modulo grava e le a sua secao como colunas
+ * contiguas (handles no lugar de ponteiros), entao a restauracao copia os
+ * vetores direto do arquivo mapeado em memoria, sem reinserir processos nem
+ * reconstruir indices. O cabecalho tem versao, ordem dos bytes, tamanho do
+ * arquivo e somas de verificacao do cabecalho e de cada secao, conferidas
+ * antes de qualquer leitura.
+ */
+
+#define SNAP_MAGIC 0x504E534CU       // "LSNP" no inicio do arquivo
+#define SNAP_VERSION 1
+#define SNAP_BYTE_ORDER 0x01020304U  // gravado na ordem da maquina (outra ordem eh recusada)
+#define SNAP_ALIGN 64                // alinhamento do inicio de cada secao no arquivo
+#define SNAP_MAX_SECTIONS 8          // secoes no cabecalho
+
+// secoes
+#define SNAP_SEC_SIM 1   // estado da simulacao (main.c)
+#define SNAP_SEC_PROC 2  // tabela e listas de processos
+#define SNAP_SEC_SCHED 3 // CPUs, slots e sorteio entre slots
+#define SNAP_SEC_LOTT 4  // parametros, filas e indices da loteria
+#define SNAP_SEC_WHEEL 5 // roda de tempo da simulacao por eventos
+
+// resultados de snapOpen
+#define SNAP_ERR_OPEN 0     // arquivo inexistente ou ilegivel
+#define SNAP_ERR_FORMAT -1  // nao eh um instantaneo ou tem outra versao ou arquitetura
+#define SNAP_ERR_CORRUPT -2 // tamanho ou soma de verificacao diferente da gravada
+
+typedef struct snap_section
+{
+        uint32_t id;       // SNAP_SEC_*
+        uint32_t reserved;
+        uint64_t offset;   // inicio da secao no arquivo
+        uint64_t size;     // bytes da secao
+        uint64_t checksum; // soma de verificacao dos bytes da secao
+} SnapSection;
+
+typedef struct snap_header
+{
+        uint32_t magic;                           // SNAP_MAGIC
+        uint16_t version;                         // SNAP_VERSION
+        uint16_t num_sections;                    // secoes gravadas
+        uint32_t byte_order;                      // SNAP_BYTE_ORDER
+        uint32_t header_size;                     // sizeof(SnapHeader)
+        uint64_t file_size;                       // tamanho do arquivo (detecta truncamento)
+        uint64_t checksum;                        // soma de verificacao do cabecalho (com este campo zerado)
+        SnapSection sections[SNAP_MAX_SECTIONS];  // tabela de secoes
+} SnapHeader;
+
+// instantaneo em gravacao ou mapeado para leitura
+typedef struct snapshot
+{
+        SnapHeader header;   // cabecalho
+        FILE *file;          // arquivo em gravacao (NULL na leitura)
+        uint64_t offset;     // bytes ja gravados
+        int current;         // secao em gravacao ou -1
+        int error;           // 1 caso alguma escrita ou leitura tenha falhado
+        const uint8_t *data; // arquivo mapeado
+        size_t size;         // tamanho do arquivo mapeado
+        const uint8_t *pos;  // proxima leitura da secao atual
+        const uint8_t *end;  // fim da secao atual
+} Snapshot;
+
+/**
+ * @brief Funcao que cria um arquivo de instantaneo vazio
+ *
+ * @param s instantaneo
+ * @param path caminho do arquivo
+ * @return int 1 caso o arquivo seja criado e 0, caso contrario
+ */
+int snapCreate(Snapshot *s, const char *path);
+
+/**
+ * @brief Funcao que inicia uma secao, encerrando a anterior
+ *
+ * @param s instantaneo
+ * @param id identificador da secao (SNAP_SEC_*)
+ */
+void snapBeginSection(Snapshot *s, int id);
+
+/**
+ * @brief Funcao que grava bytes na secao atual, completando ate multiplo de 8 (vetores ficam alinhados)
+ *
+ * @param s instantaneo
+ * @param data dados
+ * @param size quantidade de bytes
+ */
+void snapWrite(Snapshot *s, const void *data, size_t size);
+
+/**
+ * @brief Funcao que encerra a gravacao, completando o cabecalho
+ *
+ * @param s instantaneo
+ * @return int 1 caso o instantaneo seja gravado por completo e 0, caso contrario
+ */
+int snapFinish(Snapshot *s);
+
+/**
+ * @brief Funcao que abre um instantaneo, mapeando o arquivo e conferindo cabecalho, tamanho e somas de verificacao
+ *
+ * @param s instantaneo
+ * @param path caminho do arquivo
+ * @return int 1 caso o instantaneo seja valido e SNAP_ERR_*, caso contrario
+ */
+int snapOpen(Snapshot *s, const char *path);
+
+/**
+ * @brief Funcao que posiciona a leitura no inicio de uma secao
+ *
+ * @param s instantaneo
+ * @param id identificador da secao
+ * @return int 1 caso a secao exista e 0, caso contrario
+ */
+int snapSeek(Snapshot *s, int id);
+
+/**
+ * @brief Funcao que le bytes da secao atual, direto do arquivo mapeado
+ *
+ * @param s instantaneo
+ * @param size quantidade de bytes (o mesmo tamanho passado a snapWrite)
+ * @return const void* dados ou NULL, caso a secao termine antes
+ */
+const void *snapRead(Snapshot *s, size_t size);
+
+/**
+ * @brief Funcao que fecha um instantaneo aberto por snapOpen
+ *
+ * @param s instantaneo
+ */
+void snapClose(Snapshot *s);
+
+#endif
@@ -0,0 +1,392 @@
+#include "stride.h"
+#include "lottery.h"
+#include "proctable.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+#define STRD_PASS_LIMIT (1LL << 61) // passo que dispara a renormalizacao (longe do estouro de 64 bits)
+
+// variaveis auxiliares
+const char nameStride[] = "STRD";
+int indexStride = -1;
+SchedInfo *strdSched = NULL; // informacoes registradas, com os contadores
+
+int *strdHeap = NULL;		// handles dos processos no sorteio, em heap binario pelo passo
+int strdHeapSize = 0;		// quantidade de processos no heap
+int strdHeapCapacity = 0;	// capacidade alocada para o heap
+
+// colunas indexadas pelo handle do processo
+int64_t *strdPass = NULL;	 // passo (no heap) ou quanto falta para a vez (fora do heap)
+int64_t *strdStride = NULL;	 // avanco do passo a cada quantum
+int64_t *strdTickets = NULL; // tickets usados no calculo do avanco
+int *strdPos = NULL;		 // posicao no heap ou -1
+int strdCapacity = 0;		 // handles alocados
+
+int64_t strdGlobalPass = 0;	   // passo global, avancado a cada quantum pelo total de tickets
+int64_t strdGlobalTickets = 0; // tickets dos processos no heap
+pthread_mutex_t strdLock = PTHREAD_MUTEX_INITIALIZER; // trava do heap e das colunas
+
+/**
+ * @brief Funcao que retorna o avanco do passo de um processo com tickets
+ *
+ * @param tickets numero de tickets (maior que zero)
+ * @return int64_t avanco
+ */
+static int64_t strdStrideOf(int64_t tickets)
+{
+	int64_t stride = STRD_STRIDE1 / tickets;
+	return stride > 0 ? stride : 1; // mais de STRD_STRIDE1 tickets
+}
+
+/**
+ * @brief Funcao que garante espaco nas colunas para um handle
+ *
+ * @param handle handle do processo
+ */
+static void strdReserve(int handle)
+{
+	int capacity = strdCapacity ? strdCapacity : 64, i;
+
+	if (handle < strdCapacity)
+		return;
+	while (capacity <= handle) // dobra a capacidade
+		capacity *= 2;
+	strdPass = realloc(strdPass, capacity * sizeof(int64_t));
+	strdStride = realloc(strdStride, capacity * sizeof(int64_t));
+	strdTickets = realloc(strdTickets, capacity * sizeof(int64_t));
+	strdPos = realloc(strdPos, capacity * sizeof(int));
+	for (i = strdCapacity; i < capacity; i++)
+		strdPos[i] = -1;
+	strdCapacity = capacity;
+}
+
+/**
+ * @brief Funcao que compara dois processos do heap (desempate pelo handle, para ser deterministico)
+ *
+ * @param a handle
+ * @param b handle
+ * @return int 1 caso a tenha prioridade sobre b e 0, caso contrario
+ */
+static int strdLess(int a, int b)
+{
+	return strdPass[a] < strdPass[b] || (strdPass[a] == strdPass[b] && a < b);
+}
+
+/**
+ * @brief Funcao que coloca um processo em uma posicao do heap
+ *
+ * @param i posicao
+ * @param handle handle do processo
+ */
+static void strdPlace(int i, int handle)
+{
+	strdHeap[i] = handle;
+	strdPos[handle] = i;
+}
+
+/**
+ * @brief Funcao que sobe um processo no heap ate a sua posicao
+ *
+ * @param i posicao
+ */
+static void strdSiftUp(int i)
+{
+	int handle = strdHeap[i], parent;
+
+	for (; i > 0; i = parent)
+	{
+		parent = (i - 1) / 2;
+		if (!strdLess(handle, strdHeap[parent]))
+			break;
+		strdPlace(i, strdHeap[parent]);
+	}
+	strdPlace(i, handle);
+}
+
+/**
+ * @brief Funcao que desce um processo no heap ate a sua posicao
+ *
+ * @param i posicao
+ */
+static void strdSiftDown(int i)
+{
+	int handle = strdHeap[i], child;
+
+	for (; (child = 2 * i + 1) < strdHeapSize; i = child)
+	{
+		if (child + 1 < strdHeapSize && strdLess(strdHeap[child + 1], strdHeap[child]))
+			child++;
+		if (!strdLess(strdHeap[child], handle))
+			break;
+		strdPlace(i, strdHeap[child]);
+	}
+	strdPlace(i, handle);
+}
+
+/**
+ * @brief Funcao que insere um processo no heap em O(log n)
+ *
+ * @param handle handle do processo
+ */
+static void strdHeapInsert(int handle)
+{
+	if (strdHeapSize == strdHeapCapacity) // dobra a capacidade
+	{
+		strdHeapCapacity = strdHeapCapacity ? strdHeapCapacity * 2 : 16;
+		strdHeap = realloc(strdHeap, strdHeapCapacity * sizeof(int));
+	}
+	strdPlace(strdHeapSize++, handle);
+	strdSiftUp(strdHeapSize - 1);
+}
+
+/**
+ * @brief Funcao que remove um processo do heap em O(log n), colocando o ultimo no seu lugar
+ *
+ * @param handle handle do processo
+ */
+static void strdHeapRemove(int handle)
+{
+	int i = strdPos[handle], last = strdHeap[--strdHeapSize];
+
+	strdPos[handle] = -1;
+	if (i < strdHeapSize)
+	{
+		strdPlace(i, last);
+		strdSiftUp(i);
+		strdSiftDown(strdPos[last]);
+	}
+}
+
+/**
+ * @brief Funcao que subtrai o menor passo de todos os passos, evitando o estouro
+ *
+ * A ordem do heap nao muda; quem esta fora do heap guarda valores relativos.
+ *
+ */
+static void strdRenormalize(void)
+{
+	int64_t base = strdPass[strdHeap[0]];
+	int i;
+
+	if (strdGlobalPass < base)
+		base = strdGlobalPass;
+	for (i = 0; i < strdHeapSize; i++)
+		strdPass[strdHeap[i]] -= base;
+	strdGlobalPass -= base;
+	SCHED_STATS(strdSched)->rebuilds++;
+	SCHED_STATS(strdSched)->scanned += strdHeapSize;
+}
+
+/**
+ * @brief Funcao que coloca um processo no heap, retomando o que faltava a partir do passo global
+ *
+ * @param handle handle do processo
+ */
+static void strdJoin(int handle)
+{
+	strdPass[handle] += strdGlobalPass;
+	strdGlobalTickets += strdTickets[handle];
+	strdHeapInsert(handle);
+}
+
+/**
+ * @brief Funcao que tira um processo do heap, guardando quanto faltava para a sua vez
+ *
+ * @param handle handle do processo
+ */
+static void strdLeave(int handle)
+{
+	strdHeapRemove(handle);
+	strdGlobalTickets -= strdTickets[handle];
+	strdPass[handle] -= strdGlobalPass;
+}
+
+/**
+ * @brief Funcao que ajusta o passo de um processo a um novo numero de tickets em O(log n)
+ *
+ * O que falta para a vez do processo eh multiplicado pela razao entre o novo
+ * e o antigo avanco, como no artigo original.
+ *
+ * @param handle handle do processo
+ * @param tickets novo numero de tickets (maior que zero)
+ */
+static void strdRescale(int handle, int64_t tickets)
+{
+	int64_t stride = strdStrideOf(tickets);
+	int inHeap = strdPos[handle] >= 0;
+	int64_t remain = inHeap ? strdPass[handle] - strdGlobalPass : strdPass[handle];
+
+	remain = (int64_t)((__int128)remain * stride / strdStride[handle]);
+	if (inHeap)
+		strdGlobalTickets += tickets - strdTickets[handle];
+	strdStride[handle] = stride;
+	strdTickets[handle] = tickets;
+
+	if (inHeap)
+	{
+		strdPass[handle] = strdGlobalPass + remain;
+		strdSiftUp(strdPos[handle]);
+		strdSiftDown(strdPos[handle]);
+	}
+	else
+		strdPass[handle] = remain;
+}
+
+/**
+ * @brief Funcao que realiza a inicializacao do escalonador por passos
+ *
+ */
+void strdInitSchedInfo(void)
+{
+	SchedInfo *sched = malloc(sizeof(SchedInfo)); // cria o ponteiro
+
+	// nome do escalonador
+	for (int i = 0; i < 4; i++)
+		sched->name[i] = nameStride[i];
+
+	// funcoes necessarias para o escalonador funcionar
+	sched->initParamsFn = &strdInitSchedParams;
+	sched->notifyProcStatusChangeFn = &strdNotifyProcStatusChange;
+	sched->scheduleFn = &strdSchedule;
+	sched->scheduleCpuFn = NULL; // todas as CPUs escolhem no mesmo heap
+	sched->scheduleManyFn = NULL;
+	sched->chargeQuantumFn = &strdChargeQuantum;
+	sched->setNumCpusFn = NULL;
+	sched->releaseParamsFn = &strdReleaseParams;
+
+	indexStride = schedRegisterScheduler(sched); // registra o algoritmo de escalonamento
+	strdSched = sched;
+}
+
+/**
+ * @brief Funcao que inicializa os parametros de escalonamento de um processo
+ *
+ * @param p processo
+ * @param params parametros (LotterySchedParams)
+ */
+void strdInitSchedParams(Process *p, void *params)
+{
+	int64_t tickets = ((LotterySchedParams *)params)->num_tickets;
+	int handle = processGetHandle(p);
+
+	((LotterySchedParams *)params)->index_pos = -1; // posicao fica em strdPos
+	schedSetScheduler(p, params, indexStride);
+	processSetTickets(p, tickets);
+
+	pthread_mutex_lock(&strdLock);
+	strdReserve(handle);
+	strdTickets[handle] = tickets;
+	strdStride[handle] = tickets > 0 ? strdStrideOf(tickets) : STRD_STRIDE1;
+	strdPass[handle] = strdStride[handle]; // primeira vez um avanco depois do passo global
+	strdPos[handle] = -1;
+	pthread_mutex_unlock(&strdLock);
+}
+
+/**
+ * @brief Funcao que recebe a notificacao que um processo mudou de estado ou de tickets
+ *
+ * @param p processo
+ */
+void strdNotifyProcStatusChange(Process *p)
+{
+	LotterySchedParams *params = processGetSchedParams(p);
+	int64_t tickets = params->num_tickets;
+	int handle = processGetHandle(p), status = processGetStatus(p);
+	int runnable = (status == PROC_READY || status == PROC_RUNNING) && tickets > 0;
+
+	pthread_mutex_lock(&strdLock);
+	if (strdPos[handle] >= 0 && !runnable) // bloqueou ou ficou sem tickets
+		strdLeave(handle);
+	if (tickets > 0 && tickets != strdTickets[handle]) // transferencia ou inflacao
+		strdRescale(handle, tickets);
+	else if (tickets == 0)
+		strdTickets[handle] = 0;
+	if (strdPos[handle] < 0 && runnable) // entrou no heap
+		strdJoin(handle);
+	pthread_mutex_unlock(&strdLock);
+}
+
+/**
+ * @brief Funcao que escolhe o processo pronto com o menor passo em O(log n)
+ *
+ * Processos executando em outras CPUs saem do topo temporariamente.
+ *
+ * @param plist processo
+ * @return Process* processo escolhido
+ */
+Process *strdSchedule(Process *plist)
+{
+	ProcTable *table = processGetTable();
+	int skipped[SCHED_MAX_CPUS], numSkipped = 0, handle = -1, i;
+
+	pthread_mutex_lock(&strdLock);
+	while (strdHeapSize > 0)
+	{
+		handle = strdHeap[0];
+		if (__atomic_load_n(&table->status[handle], __ATOMIC_ACQUIRE) == PROC_READY || numSkipped == SCHED_MAX_CPUS)
+			break;
+		skipped[numSkipped++] = handle; // executando em outra CPU
+		strdHeapRemove(handle);
+		handle = -1;
+	}
+	for (i = 0; i < numSkipped; i++)
+		strdHeapInsert(skipped[i]);
+	SCHED_STATS(strdSched)->scanned += numSkipped + 1;
+	if (handle < 0 || __atomic_load_n(&table->status[handle], __ATOMIC_ACQUIRE) != PROC_READY)
+	{
+		pthread_mutex_unlock(&strdLock);
+		return NULL;
+	}
+
+	// o escolhido avanca seu passo pelo quantum que vai executar
+	strdPass[handle] += strdStride[handle];
+	strdSiftDown(strdPos[handle]);
+	strdGlobalPass += STRD_STRIDE1 / strdGlobalTickets;
+	if (strdPass[handle] > STRD_PASS_LIMIT)
+		strdRenormalize();
+	pthread_mutex_unlock(&strdLock);
+
+	return table->proc[handle];
+}
+
+/**
+ * @brief Funcao que devolve ao passo de um processo a parte nao usada do quantum, em O(log n)
+ *
+ * @param p processo
+ * @param used fracao usada do quantum, entre 0 e SCHED_QUANTUM_UNITS
+ */
+void strdChargeQuantum(Process *p, int used)
+{
+	int handle = processGetHandle(p);
+	int64_t refund;
+
+	pthread_mutex_lock(&strdLock);
+	refund = (int64_t)((__int128)strdStride[handle] * (SCHED_QUANTUM_UNITS - used) / SCHED_QUANTUM_UNITS);
+	strdPass[handle] -= refund; // o passo avanca so pela fracao usada
+	if (strdPos[handle] >= 0)
+		strdSiftUp(strdPos[handle]);
+	pthread_mutex_unlock(&strdLock);
+	if (refund > 0)
+		SCHED_STATS(strdSched)->compensations++;
+}
+
+/**
+ * @brief Funcao que libera os parametros de escalonamento de um processo
+ *
+ * @param p processo
+ * @return int numero do slot do processo que ele estava associado
+ */
+int strdReleaseParams(Process *p)
+{
+	int slot = processGetSchedSlot(p); // inicializa o slot
+	int handle = processGetHandle(p);
+
+	LotterySchedParams *params = processGetSchedParams(p); // inicializa os parametros
+	pthread_mutex_lock(&strdLock);
+	if (strdPos[handle] >= 0) // se esta no heap, sai
+		strdLeave(handle);
+	pthread_mutex_unlock(&strdLock);
+	lottFreeParams(params); // devolve ao pool
+
+	return slot;
+}
@@ -0,0 +1,68 @@
+#ifndef STRIDE_H
+#define STRIDE_H
+
+#include <stdint.h>
+#include "scheduler.h"
+
+/*
+ * Escalonador por passos (stride scheduling, Waldspurger): versao deterministica
+ * da loteria. Usa os mesmos tickets (LotterySchedParams); cada processo avanca
+ * seu passo em STRD_STRIDE1 / tickets a cada quantum e o processo com o menor
+ * passo executa, escolhido em um heap binario em O(log n).
+ */
+
+#define STRD_STRIDE1 (1LL << 40) // passo de um processo com um ticket
+
+/**
+ * @brief Funcao que realiza a inicializacao do escalonador por passos
+ *
+ */
+void strdInitSchedInfo(void);
+
+/**
+ * @brief Funcao que inicializa os parametros de escalonamento de um processo
+ *
+ * @param p processo
+ * @param params parametros (LotterySchedParams)
+ */
+void strdInitSchedParams(Process *p, void *params);
+
+/**
+ * @brief Funcao que recebe a notificacao que um processo mudou de estado ou de tickets
+ *
+ * Ao sair do heap o processo guarda quanto faltava para a sua vez e, ao voltar,
+ * retoma a partir do passo global; com os tickets alterados, o que falta eh
+ * reescalado para o novo passo, sem reordenar o heap inteiro.
+ *
+ * @param p processo
+ */
+void strdNotifyProcStatusChange(Process *p);
+
+/**
+ * @brief Funcao que escolhe o processo pronto com o menor passo em O(log n)
+ *
+ * @param plist processo
+ * @return Process* processo escolhido
+ */
+Process *strdSchedule(Process *plist);
+
+/**
+ * @brief Funcao que devolve ao passo de um processo a parte nao usada do quantum, em O(log n)
+ *
+ * Equivale aos tickets de compensacao da loteria: quem usa a fracao f do
+ * quantum avanca o passo so em f vezes o seu avanco.
+ *
+ * @param p processo
+ * @param used fracao usada do quantum, entre 0 e SCHED_QUANTUM_UNITS
+ */
+void strdChargeQuantum(Process *p, int used);
+
+/**
+ * @brief Funcao que libera os parametros de escalonamento de um processo
+ *
+ * @param p processo
+ * @return int numero do slot do processo que ele estava associado
+ */
+int strdReleaseParams(Process *p);
+
+#endif
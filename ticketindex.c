@@ -0,0 +1,354 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ticketindex.h"
+#include "ticketkernels.h"
+
+/**
+ * @brief Funcao que soma um valor a uma posicao da arvore de Fenwick
+ *
+ * @param idx indice
+ * @param pos posicao (base 0)
+ * @param delta valor a ser somado
+ */
+static void tidxAdd(TicketIndex *idx, int pos, int64_t delta)
+{
+	int i;
+	if (idx->valid) // com a arvore invalida basta atualizar o peso, ela sera refeita no sorteio
+		for (i = pos + 1; i <= idx->capacity; i += i & -i) // sobe pelos nos responsaveis pela posicao
+			idx->tree[i] += delta;
+	__atomic_store_n(&idx->total, idx->total + delta, __ATOMIC_RELAXED); // lido sem trava por outras filas
+}
+
+/**
+ * @brief Funcao que reconstroi a arvore a partir dos tickets de cada posicao em O(n)
+ *
+ * O no i cobre as posicoes (i - lowbit(i), i], entao seu valor eh a diferenca
+ * entre duas somas de prefixos, calculadas pelo kernel vetorizado.
+ *
+ * @param idx indice
+ */
+static void tidxBuild(TicketIndex *idx)
+{
+	int64_t total = tkMaskedPrefixSum(idx->weight, NULL, 0, idx->size, idx->prefix);
+	int64_t left;
+	int i, start;
+
+	for (i = 1; i <= idx->capacity; i++)
+	{
+		start = i - (i & -i); // ultima posicao fora do intervalo do no
+		left = start == 0 ? 0 : (start <= idx->size ? idx->prefix[start - 1] : total);
+		idx->tree[i] = (i <= idx->size ? idx->prefix[i - 1] : total) - left;
+	}
+
+	idx->valid = 1;
+	idx->rebuilds++;
+	idx->scanned += idx->capacity;
+}
+
+/**
+ * @brief Funcao que dobra a capacidade do indice
+ *
+ * @param idx indice
+ */
+static void tidxGrow(TicketIndex *idx)
+{
+	int capacity = idx->capacity * 2;
+
+	idx->tree = realloc(idx->tree, (capacity + 1) * sizeof(int64_t));
+	idx->weight = realloc(idx->weight, capacity * sizeof(int64_t));
+	idx->items = realloc(idx->items, capacity * sizeof(Process *));
+	idx->free_pos = realloc(idx->free_pos, capacity * sizeof(int));
+	idx->prefix = realloc(idx->prefix, capacity * sizeof(int64_t));
+	idx->capacity = capacity;
+
+	idx->valid = 0; // os nos novos cobrem intervalos antigos, entao a arvore sera refeita
+}
+
+/**
+ * @brief Funcao que inicializa um indice de tickets vazio
+ *
+ * @param idx indice
+ * @param capacity capacidade inicial
+ */
+void tidxInit(TicketIndex *idx, int capacity)
+{
+	if (capacity < 1)
+		capacity = 1;
+	idx->tree = calloc(capacity + 1, sizeof(int64_t));
+	idx->weight = malloc(capacity * sizeof(int64_t));
+	idx->items = malloc(capacity * sizeof(Process *));
+	idx->free_pos = malloc(capacity * sizeof(int));
+	idx->prefix = malloc(capacity * sizeof(int64_t));
+	idx->num_free = 0;
+	idx->size = 0;
+	idx->capacity = capacity;
+	idx->total = 0;
+	idx->valid = 1;
+	idx->rebuilds = 0;
+	idx->scanned = 0;
+}
+
+/**
+ * @brief Funcao que libera a memoria de um indice de tickets
+ *
+ * @param idx indice
+ */
+void tidxFree(TicketIndex *idx)
+{
+	free(idx->tree);
+	free(idx->weight);
+	free(idx->items);
+	free(idx->free_pos);
+	free(idx->prefix);
+	idx->tree = NULL;
+	idx->weight = NULL;
+	idx->items = NULL;
+	idx->free_pos = NULL;
+	idx->prefix = NULL;
+	idx->num_free = idx->size = idx->capacity = idx->total = 0;
+}
+
+/**
+ * @brief Funcao que insere um processo no indice em O(log n)
+ *
+ * @param idx indice
+ * @param p processo
+ * @param tickets numero de tickets do processo
+ * @return int posicao ocupada pelo processo
+ */
+int tidxInsert(TicketIndex *idx, Process *p, int64_t tickets)
+{
+	int pos;
+
+	if (idx->num_free > 0) // reaproveita uma posicao liberada
+		pos = idx->free_pos[--idx->num_free];
+	else
+	{
+		if (idx->size == idx->capacity)
+			tidxGrow(idx);
+		pos = idx->size++;
+	}
+
+	idx->items[pos] = p;
+	idx->weight[pos] = tickets;
+	tidxAdd(idx, pos, tickets);
+	return pos;
+}
+
+/**
+ * @brief Funcao que remove o processo de uma posicao do indice em O(log n)
+ *
+ * @param idx indice
+ * @param pos posicao
+ */
+void tidxRemove(TicketIndex *idx, int pos)
+{
+	tidxAdd(idx, pos, -idx->weight[pos]);
+	idx->weight[pos] = 0;
+	idx->items[pos] = NULL;
+	idx->free_pos[idx->num_free++] = pos;
+}
+
+/**
+ * @brief Funcao que altera o numero de tickets de uma posicao em O(log n)
+ *
+ * @param idx indice
+ * @param pos posicao
+ * @param tickets novo numero de tickets
+ */
+void tidxUpdate(TicketIndex *idx, int pos, int64_t tickets)
+{
+	tidxAdd(idx, pos, tickets - idx->weight[pos]);
+	idx->weight[pos] = tickets;
+}
+
+/**
+ * @brief Funcao que retorna a posicao dona de um bilhete, descendo a arvore em O(log n)
+ *
+ * @param idx indice
+ * @param ticket bilhete sorteado (entre 0 e o total de tickets)
+ * @return int posicao dona do bilhete ou -1, caso nao exista
+ */
+int tidxFindPos(TicketIndex *idx, int64_t ticket)
+{
+	int pos = 0, step = 1;
+
+	if (ticket < 0 || ticket >= idx->total)
+		return -1;
+
+	if (!idx->valid) // reconstrucao apenas quando a arvore foi invalidada
+		tidxBuild(idx);
+
+	while (step * 2 <= idx->capacity) // maior potencia de 2 dentro da arvore
+		step *= 2;
+
+	// desce pela arvore pulando os intervalos cuja soma nao alcanca o bilhete
+	for (; step > 0; step /= 2, idx->scanned++)
+	{
+		if (pos + step <= idx->capacity && idx->tree[pos + step] <= ticket)
+		{
+			pos += step;
+			ticket -= idx->tree[pos];
+		}
+	}
+
+	return pos; // pos eh a quantidade de posicoes puladas, ou seja, a posicao sorteada (base 0)
+}
+
+/**
+ * @brief Funcao que retorna o processo dono de um bilhete, descendo a arvore em O(log n)
+ *
+ * @param idx indice
+ * @param ticket bilhete sorteado (entre 0 e o total de tickets)
+ * @return Process* processo dono do bilhete ou NULL, caso nao exista
+ */
+Process *tidxFind(TicketIndex *idx, int64_t ticket)
+{
+	int pos = tidxFindPos(idx, ticket);
+	return pos < 0 ? NULL : idx->items[pos];
+}
+
+/**
+ * @brief Funcao que retorna os tickets de uma posicao
+ *
+ * @param idx indice
+ * @param pos posicao
+ * @return int64_t tickets da posicao
+ */
+int64_t tidxWeight(TicketIndex *idx, int pos)
+{
+	return idx->weight[pos];
+}
+
+/**
+ * @brief Funcao que retorna o processo de uma posicao
+ *
+ * @param idx indice
+ * @param pos posicao
+ * @return Process* processo ou NULL, caso a posicao esteja livre
+ */
+Process *tidxItem(TicketIndex *idx, int pos)
+{
+	return idx->items[pos];
+}
+
+/**
+ * @brief Funcao que marca a arvore como invalida, adiando a reconstrucao para o proximo sorteio
+ *
+ * @param idx indice
+ */
+void tidxInvalidate(TicketIndex *idx)
+{
+	idx->valid = 0;
+}
+
+/**
+ * @brief Funcao que retorna quantas vezes a arvore foi reconstruida por completo
+ *
+ * @param idx indice
+ * @return long numero de reconstrucoes
+ */
+long tidxGetRebuilds(TicketIndex *idx)
+{
+	return idx->rebuilds;
+}
+
+/**
+ * @brief Funcao que retorna quantos nos da arvore foram percorridos em sorteios e reconstrucoes
+ *
+ * @param idx indice
+ * @return long nos percorridos
+ */
+long tidxGetScanned(TicketIndex *idx)
+{
+	return idx->scanned;
+}
+
+/**
+ * @brief Funcao que retorna o total de tickets do indice
+ *
+ * @param idx indice
+ * @return int64_t total de tickets
+ */
+int64_t tidxTotal(TicketIndex *idx)
+{
+	return idx->total;
+}
+
+// cabecalho de um indice no instantaneo
+typedef struct tidx_snap_info
+{
+	int32_t size;	  // posicoes usadas
+	int32_t num_free; // posicoes livres
+	int32_t capacity; // capacidade (define o formato da arvore)
+	int32_t valid;	  // 0 caso a arvore precise ser reconstruida
+	int64_t total;	  // soma dos tickets
+} TidxSnapInfo;
+
+/**
+ * @brief Funcao que grava o indice no instantaneo, com os handles dos processos no lugar dos ponteiros
+ *
+ * @param idx indice
+ * @param s instantaneo em gravacao (dentro da secao do escalonador)
+ */
+void tidxSave(TicketIndex *idx, Snapshot *s)
+{
+	TidxSnapInfo info = {idx->size, idx->num_free, idx->capacity, idx->valid, idx->total};
+	int *handles = malloc((idx->size + 1) * sizeof(int));
+	int i;
+
+	for (i = 0; i < idx->size; i++)
+		handles[i] = idx->items[i] ? processGetHandle(idx->items[i]) : -1;
+	snapWrite(s, &info, sizeof(info));
+	snapWrite(s, idx->tree, (idx->capacity + 1) * sizeof(int64_t));
+	snapWrite(s, idx->weight, idx->size * sizeof(int64_t));
+	snapWrite(s, handles, idx->size * sizeof(int));
+	snapWrite(s, idx->free_pos, idx->num_free * sizeof(int));
+	free(handles);
+}
+
+/**
+ * @brief Funcao que restaura um indice gravado por tidxSave, copiando a arvore sem reconstrui-la
+ *
+ * @param idx indice
+ * @param s instantaneo aberto (posicionado na secao do escalonador)
+ * @param procs processo de cada handle (coluna proc da tabela de processos)
+ * @param numProcs quantidade de handles
+ * @return int 1 caso o indice seja restaurado e 0, caso contrario
+ */
+int tidxLoad(TicketIndex *idx, Snapshot *s, Process **procs, int numProcs)
+{
+	const TidxSnapInfo *info = snapRead(s, sizeof(TidxSnapInfo));
+	const int64_t *tree, *weight;
+	const int *handles, *freePos;
+	int i;
+
+	if (info == NULL || info->capacity < 1 || info->size < 0 || info->size > info->capacity ||
+		info->num_free < 0 || info->num_free > info->size)
+		return 0;
+	tree = snapRead(s, ((size_t)info->capacity + 1) * sizeof(int64_t));
+	weight = snapRead(s, info->size * sizeof(int64_t));
+	handles = snapRead(s, info->size * sizeof(int));
+	freePos = snapRead(s, info->num_free * sizeof(int));
+	if (s->error)
+		return 0;
+	for (i = 0; i < info->size; i++) // cada posicao ocupada aponta para um processo restaurado
+		if (handles[i] >= numProcs || (handles[i] >= 0 && procs[handles[i]] == NULL) || (handles[i] < 0 && weight[i] != 0))
+			return 0;
+	for (i = 0; i < info->num_free; i++)
+		if (freePos[i] < 0 || freePos[i] >= info->size || handles[freePos[i]] >= 0)
+			return 0;
+
+	tidxFree(idx);
+	tidxInit(idx, info->capacity);
+	memcpy(idx->tree, tree, ((size_t)info->capacity + 1) * sizeof(int64_t));
+	memcpy(idx->weight, weight, info->size * sizeof(int64_t));
+	memcpy(idx->free_pos, freePos, info->num_free * sizeof(int));
+	for (i = 0; i < info->size; i++)
+		idx->items[i] = handles[i] >= 0 ? procs[handles[i]] : NULL;
+	idx->size = info->size;
+	idx->num_free = info->num_free;
+	idx->total = info->total;
+	idx->valid = info->valid;
+	return 1;
+}
@@ -0,0 +1,153 @@
+#ifndef TICKETINDEX_H
+#define TICKETINDEX_H
+
+#include <stdint.h>
+#include "process.h"
+
+typedef struct ticket_index
+{
+        int64_t *tree;    // arvore de Fenwick com as somas parciais (base 1)
+        int64_t *weight;  // tickets de cada posicao
+        Process **items;  // processo associado a cada posicao
+        int64_t *prefix;  // somas acumuladas usadas na reconstrucao
+        int *free_pos;    // pilha de posicoes livres
+        int num_free;     // quantidade de posicoes livres
+        int size;         // quantidade de posicoes ja utilizadas
+        int capacity;     // capacidade alocada
+        int64_t total;    // soma dos tickets de todas as posicoes (mantida por deltas, gravada atomicamente)
+        int valid;        // 0 quando a arvore precisa ser reconstruida
+        long rebuilds;    // quantidade de reconstrucoes completas da arvore
+        long scanned;     // nos percorridos em sorteios e reconstrucoes
+} TicketIndex;
+
+/**
+ * @brief Funcao que inicializa um indice de tickets vazio
+ *
+ * @param idx indice
+ * @param capacity capacidade inicial
+ */
+void tidxInit(TicketIndex *idx, int capacity);
+
+/**
+ * @brief Funcao que libera a memoria de um indice de tickets
+ *
+ * @param idx indice
+ */
+void tidxFree(TicketIndex *idx);
+
+/**
+ * @brief Funcao que insere um processo no indice em O(log n)
+ *
+ * @param idx indice
+ * @param p processo
+ * @param tickets numero de tickets do processo
+ * @return int posicao ocupada pelo processo
+ */
+int tidxInsert(TicketIndex *idx, Process *p, int64_t tickets);
+
+/**
+ * @brief Funcao que remove o processo de uma posicao do indice em O(log n)
+ *
+ * @param idx indice
+ * @param pos posicao
+ */
+void tidxRemove(TicketIndex *idx, int pos);
+
+/**
+ * @brief Funcao que altera o numero de tickets de uma posicao em O(log n)
+ *
+ * @param idx indice
+ * @param pos posicao
+ * @param tickets novo numero de tickets
+ */
+void tidxUpdate(TicketIndex *idx, int pos, int64_t tickets);
+
+/**
+ * @brief Funcao que retorna a posicao dona de um bilhete, descendo a arvore em O(log n)
+ *
+ * @param idx indice
+ * @param ticket bilhete sorteado (entre 0 e o total de tickets)
+ * @return int posicao dona do bilhete ou -1, caso nao exista
+ */
+int tidxFindPos(TicketIndex *idx, int64_t ticket);
+
+/**
+ * @brief Funcao que retorna o processo dono de um bilhete, descendo a arvore em O(log n)
+ *
+ * @param idx indice
+ * @param ticket bilhete sorteado (entre 0 e o total de tickets)
+ * @return Process* processo dono do bilhete ou NULL, caso nao exista
+ */
+Process *tidxFind(TicketIndex *idx, int64_t ticket);
+
+/**
+ * @brief Funcao que retorna os tickets de uma posicao
+ *
+ * @param idx indice
+ * @param pos posicao
+ * @return int64_t tickets da posicao
+ */
+int64_t tidxWeight(TicketIndex *idx, int pos);
+
+/**
+ * @brief Funcao que retorna o processo de uma posicao
+ *
+ * @param idx indice
+ * @param pos posicao
+ * @return Process* processo ou NULL, caso a posicao esteja livre
+ */
+Process *tidxItem(TicketIndex *idx, int pos);
+
+/**
+ * @brief Funcao que marca a arvore como invalida, adiando a reconstrucao para o proximo sorteio
+ *
+ * @param idx indice
+ */
+void tidxInvalidate(TicketIndex *idx);
+
+/**
+ * @brief Funcao que retorna quantas vezes a arvore foi reconstruida por completo
+ *
+ * @param idx indice
+ * @return long numero de reconstrucoes
+ */
+long tidxGetRebuilds(TicketIndex *idx);
+
+/**
+ * @brief Funcao que retorna quantos nos da arvore foram percorridos em sorteios e reconstrucoes
+ *
+ * @param idx indice
+ * @return long nos percorridos
+ */
+long tidxGetScanned(TicketIndex *idx);
+
+/**
+ * @brief Funcao que retorna o total de tickets do indice
+ *
+ * @param idx indice
+ * @return int64_t total de tickets
+ */
+int64_t tidxTotal(TicketIndex *idx);
+
+/**
+ * @brief Funcao que grava o indice no instantaneo, com os handles dos processos no lugar dos ponteiros
+ *
+ * @param idx indice
+ * @param s instantaneo em gravacao (dentro da secao do escalonador)
+ */
+void tidxSave(TicketIndex *idx, Snapshot *s);
+
+/**
+ * @brief Funcao que restaura um indice gravado por tidxSave, copiando a arvore sem reconstrui-la
+ *
+ * O indice deve estar vazio (recem-inicializado); em caso de falha ele nao eh alterado.
+ *
+ * @param idx indice
+ * @param s instantaneo aberto (posicionado na secao do escalonador)
+ * @param procs processo de cada handle (coluna proc da tabela de processos)
+ * @param numProcs quantidade de handles
+ * @return int 1 caso o indice seja restaurado e 0, caso contrario
+ */
+int tidxLoad(TicketIndex *idx, Snapshot *s, Process **procs, int numProcs);
+
+#endif
@@ -0,0 +1,231 @@
+#include <stddef.h>
+#include <pthread.h>
+#include "ticketkernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TK_X86 1
+#endif
+
+// kernels escolhidos em tempo de execucao
+static int64_t (*prefixFn)(const int64_t *, const int *, int, int, int64_t *) = NULL;
+static int (*searchFn)(const int64_t *, int, int64_t) = NULL;
+static int currentIsa = -1;
+static pthread_once_t tkIsaOnce = PTHREAD_ONCE_INIT; // escolha padrao, uma unica vez entre as threads
+
+/**
+ * @brief Funcao escalar da soma de prefixos com mascara
+ */
+static int64_t tkPrefixScalar(const int64_t *tickets, const int *status, int statusValue, int n, int64_t *prefix)
+{
+	int64_t sum = 0;
+	int i;
+
+	for (i = 0; i < n; i++)
+	{
+		if (status == NULL || status[i] == statusValue)
+			sum += tickets[i];
+		prefix[i] = sum;
+	}
+	return sum;
+}
+
+/**
+ * @brief Funcao escalar da busca do bilhete sorteado
+ */
+static int tkSearchScalar(const int64_t *prefix, int n, int64_t ticket)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (prefix[i] > ticket)
+			return i;
+	return -1;
+}
+
+#ifdef TK_X86
+
+/**
+ * @brief Funcao AVX2 da soma de prefixos com mascara: 4 posicoes por iteracao
+ */
+__attribute__((target("avx2"))) static int64_t tkPrefixAvx2(const int64_t *tickets, const int *status, int statusValue,
+															int n, int64_t *prefix)
+{
+	__m256i carry = _mm256_setzero_si256(), zero = _mm256_setzero_si256(), x, t;
+	__m128i want = _mm_set1_epi32(statusValue);
+	int64_t sum;
+	int i;
+
+	for (i = 0; i + 4 <= n; i += 4)
+	{
+		x = _mm256_loadu_si256((const __m256i *)(tickets + i));
+		if (status != NULL) // zera os tickets das posicoes com outro status
+			x = _mm256_and_si256(x, _mm256_cvtepi32_epi64(
+										_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(status + i)), want)));
+
+		// soma de prefixos dentro do vetor: desloca 1 e depois 2 posicoes
+		t = _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x03);
+		x = _mm256_add_epi64(x, t);
+		t = _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x0F);
+		x = _mm256_add_epi64(x, t);
+
+		x = _mm256_add_epi64(x, carry); // soma acumulada dos vetores anteriores
+		_mm256_storeu_si256((__m256i *)(prefix + i), x);
+		carry = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+
+	sum = i > 0 ? prefix[i - 1] : 0;
+	for (; i < n; i++) // restante
+	{
+		if (status == NULL || status[i] == statusValue)
+			sum += tickets[i];
+		prefix[i] = sum;
+	}
+	return sum;
+}
+
+/**
+ * @brief Funcao AVX2 da busca do bilhete: compara 4 somas e extrai a mascara
+ */
+__attribute__((target("avx2"))) static int tkSearchAvx2(const int64_t *prefix, int n, int64_t ticket)
+{
+	__m256i t = _mm256_set1_epi64x(ticket);
+	int i, mask;
+
+	for (i = 0; i + 4 <= n; i += 4)
+	{
+		mask = _mm256_movemask_pd(_mm256_castsi256_pd(
+			_mm256_cmpgt_epi64(_mm256_loadu_si256((const __m256i *)(prefix + i)), t)));
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+	for (; i < n; i++)
+		if (prefix[i] > ticket)
+			return i;
+	return -1;
+}
+
+/**
+ * @brief Funcao AVX-512 da busca do bilhete: compara 8 somas por iteracao
+ */
+__attribute__((target("avx512f"))) static int tkSearchAvx512(const int64_t *prefix, int n, int64_t ticket)
+{
+	__m512i t = _mm512_set1_epi64(ticket);
+	__mmask8 mask;
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8)
+	{
+		mask = _mm512_cmpgt_epi64_mask(_mm512_loadu_si512((const void *)(prefix + i)), t);
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+	for (; i < n; i++)
+		if (prefix[i] > ticket)
+			return i;
+	return -1;
+}
+
+#endif
+
+/**
+ * @brief Funcao que aponta os kernels para um conjunto de instrucoes
+ *
+ * @param isa TK_ISA_SCALAR, TK_ISA_AVX2 ou TK_ISA_AVX512
+ * @return int conjunto efetivamente escolhido (limitado ao que a CPU suporta)
+ */
+static int tkSelectIsa(int isa)
+{
+	prefixFn = &tkPrefixScalar;
+	searchFn = &tkSearchScalar;
+	currentIsa = TK_ISA_SCALAR;
+
+#ifdef TK_X86
+	__builtin_cpu_init();
+	if (isa >= TK_ISA_AVX2 && __builtin_cpu_supports("avx2"))
+	{
+		prefixFn = &tkPrefixAvx2;
+		searchFn = &tkSearchAvx2;
+		currentIsa = TK_ISA_AVX2;
+	}
+	if (isa >= TK_ISA_AVX512 && currentIsa == TK_ISA_AVX2 && __builtin_cpu_supports("avx512f"))
+	{
+		searchFn = &tkSearchAvx512; // a soma de prefixos continua em AVX2
+		currentIsa = TK_ISA_AVX512;
+	}
+#endif
+
+	return currentIsa;
+}
+
+/**
+ * @brief Funcao que escolhe o melhor conjunto suportado pela CPU (executada por pthread_once)
+ *
+ */
+static void tkDefaultIsa(void)
+{
+	tkSelectIsa(TK_ISA_AVX512);
+}
+
+/**
+ * @brief Funcao que escolhe o conjunto de instrucoes usado pelos kernels
+ *
+ * Deve ser chamada antes de outras threads usarem os kernels.
+ *
+ * @param isa TK_ISA_SCALAR, TK_ISA_AVX2 ou TK_ISA_AVX512
+ * @return int conjunto efetivamente escolhido (limitado ao que a CPU suporta)
+ */
+int tkSetIsa(int isa)
+{
+	pthread_once(&tkIsaOnce, &tkDefaultIsa); // a escolha padrao nao sobrescreve esta depois
+	return tkSelectIsa(isa);
+}
+
+/**
+ * @brief Funcao que retorna o nome do conjunto de instrucoes em uso
+ *
+ * @return const char* nome
+ */
+const char *tkGetIsaName(void)
+{
+	pthread_once(&tkIsaOnce, &tkDefaultIsa);
+	switch (currentIsa)
+	{
+	case TK_ISA_AVX512:
+		return "avx512";
+	case TK_ISA_AVX2:
+		return "avx2";
+	default:
+		return "escalar";
+	}
+}
+
+/**
+ * @brief Funcao que calcula a soma de prefixos dos tickets, considerando apenas as posicoes com um status
+ *
+ * @param tickets tickets de cada posicao
+ * @param status status de cada posicao ou NULL
+ * @param statusValue status que deve ser somado
+ * @param n quantidade de posicoes
+ * @param prefix saida com n somas acumuladas
+ * @return int64_t soma total
+ */
+int64_t tkMaskedPrefixSum(const int64_t *tickets, const int *status, int statusValue, int n, int64_t *prefix)
+{
+	pthread_once(&tkIsaOnce, &tkDefaultIsa);
+	return prefixFn(tickets, status, statusValue, n, prefix);
+}
+
+/**
+ * @brief Funcao que retorna a primeira posicao cuja soma acumulada ultrapassa o bilhete sorteado
+ *
+ * @param prefix somas acumuladas (nao decrescentes)
+ * @param n quantidade de posicoes
+ * @param ticket bilhete sorteado
+ * @return int posicao vencedora ou -1, caso o bilhete esteja fora do intervalo
+ */
+int tkSearch(const int64_t *prefix, int n, int64_t ticket)
+{
+	pthread_once(&tkIsaOnce, &tkDefaultIsa);
+	return searchFn(prefix, n, ticket);
+}
@@ -0,0 +1,54 @@
+#ifndef TICKETKERNELS_H
+#define TICKETKERNELS_H
+
+#include <stdint.h>
+
+#define TK_ISA_SCALAR 0 // laco escalar
+#define TK_ISA_AVX2 1   // AVX2 (4 tickets de 64 bits por vetor)
+#define TK_ISA_AVX512 2 // AVX-512F (8 comparacoes de 64 bits por vetor)
+
+/**
+ * @brief Funcao que calcula a soma de prefixos dos tickets, considerando apenas as posicoes com um status
+ *
+ * prefix[i] recebe a soma dos tickets das posicoes 0..i cujo status eh igual a
+ * statusValue. Com status NULL todas as posicoes sao somadas.
+ *
+ * @param tickets tickets de cada posicao
+ * @param status status de cada posicao ou NULL
+ * @param statusValue status que deve ser somado
+ * @param n quantidade de posicoes
+ * @param prefix saida com n somas acumuladas
+ * @return int64_t soma total
+ */
+int64_t tkMaskedPrefixSum(const int64_t *tickets, const int *status, int statusValue, int n, int64_t *prefix);
+
+/**
+ * @brief Funcao que retorna a primeira posicao cuja soma acumulada ultrapassa o bilhete sorteado
+ *
+ * @param prefix somas acumuladas (nao decrescentes)
+ * @param n quantidade de posicoes
+ * @param ticket bilhete sorteado
+ * @return int posicao vencedora ou -1, caso o bilhete esteja fora do intervalo
+ */
+int tkSearch(const int64_t *prefix, int n, int64_t ticket);
+
+/**
+ * @brief Funcao que escolhe o conjunto de instrucoes usado pelos kernels
+ *
+ * Por padrao o melhor conjunto suportado pela CPU eh escolhido no primeiro uso,
+ * uma unica vez mesmo com varias threads (pthread_once). A troca por esta
+ * funcao deve acontecer antes de outras threads usarem os kernels.
+ *
+ * @param isa TK_ISA_SCALAR, TK_ISA_AVX2 ou TK_ISA_AVX512
+ * @return int conjunto efetivamente escolhido (limitado ao que a CPU suporta)
+ */
+int tkSetIsa(int isa);
+
+/**
+ * @brief Funcao que retorna o nome do conjunto de instrucoes em uso
+ *
+ * @return const char* nome
+ */
+const char *tkGetIsaName(void);
+
+#endif
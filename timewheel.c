@@ -0,0 +1,345 @@
+#include <stdlib.h>
+#include <string.h>
+#include "timewheel.h"
+
+/**
+ * @brief Funcao que garante espaco nas colunas para um handle
+ *
+ * @param w roda de tempo
+ * @param handle handle do processo
+ */
+static void twhlReserve(TimeWheel *w, int handle)
+{
+	int capacity = w->capacity ? w->capacity : 64, i;
+
+	if (handle < w->capacity)
+		return;
+	while (capacity <= handle) // dobra a capacidade
+		capacity *= 2;
+	w->next = realloc(w->next, capacity * sizeof(int));
+	w->prev = realloc(w->prev, capacity * sizeof(int));
+	w->list = realloc(w->list, capacity * sizeof(int));
+	w->kind = realloc(w->kind, capacity * sizeof(int));
+	w->when = realloc(w->when, capacity * sizeof(long long));
+	for (i = w->capacity; i < capacity; i++)
+		w->list[i] = -1;
+	w->capacity = capacity;
+}
+
+/**
+ * @brief Funcao que coloca um handle no inicio de uma lista
+ *
+ * @param w roda de tempo
+ * @param list lista
+ * @param handle handle do processo
+ */
+static void twhlLink(TimeWheel *w, int list, int handle)
+{
+	w->list[handle] = list;
+	w->prev[handle] = -1;
+	w->next[handle] = w->head[list];
+	if (w->head[list] >= 0)
+		w->prev[w->head[list]] = handle;
+	w->head[list] = handle;
+}
+
+/**
+ * @brief Funcao que retira um handle da sua lista
+ *
+ * @param w roda de tempo
+ * @param handle handle do processo
+ */
+static void twhlUnlink(TimeWheel *w, int handle)
+{
+	if (w->prev[handle] >= 0)
+		w->next[w->prev[handle]] = w->next[handle];
+	else
+		w->head[w->list[handle]] = w->next[handle];
+	if (w->next[handle] >= 0)
+		w->prev[w->next[handle]] = w->prev[handle];
+	w->list[handle] = -1;
+}
+
+/**
+ * @brief Funcao que coloca um evento na lista do seu instante, relativo ao instante atual da roda
+ *
+ * @param w roda de tempo
+ * @param handle handle do processo
+ */
+static void twhlPlace(TimeWheel *w, int handle)
+{
+	long long when = w->when[handle];
+	unsigned long long delta;
+	int level;
+
+	if (when < w->now) // ja venceu
+	{
+		twhlLink(w, TWHL_DUE, handle);
+		return;
+	}
+	delta = (unsigned long long)(when - w->now);
+	for (level = 0; level < TWHL_LEVELS; level++) // menor nivel que alcanca o instante
+		if (delta < 1ULL << (TWHL_BITS * (level + 1)))
+		{
+			twhlLink(w, level * TWHL_SLOTS + (int)((when >> (TWHL_BITS * level)) & (TWHL_SLOTS - 1)), handle);
+			return;
+		}
+	twhlLink(w, TWHL_FAR, handle); // alem do ultimo nivel, revisto a cada volta dele
+}
+
+/**
+ * @brief Funcao que redistribui os eventos de uma lista pelos niveis de baixo
+ *
+ * @param w roda de tempo
+ * @param list lista
+ */
+static void twhlCascade(TimeWheel *w, int list)
+{
+	int handle = w->head[list], next;
+
+	w->head[list] = -1;
+	for (; handle >= 0; handle = next)
+	{
+		next = w->next[handle];
+		twhlPlace(w, handle);
+		w->cascaded++;
+	}
+}
+
+/**
+ * @brief Funcao que processa o proximo instante: redistribui os niveis que deram a volta e vence a posicao atual
+ *
+ * @param w roda de tempo
+ */
+static void twhlTick(TimeWheel *w)
+{
+	long long now = w->now;
+	int level, slot, handle;
+
+	// o nivel de cima so eh redistribuido quando o de baixo da a volta
+	for (level = 1; level < TWHL_LEVELS && (now & ((1LL << (TWHL_BITS * level)) - 1)) == 0; level++)
+	{
+		slot = (int)((now >> (TWHL_BITS * level)) & (TWHL_SLOTS - 1));
+		twhlCascade(w, level * TWHL_SLOTS + slot);
+		if (level == TWHL_LEVELS - 1 && slot == 0) // ultimo nivel deu a volta
+			twhlCascade(w, TWHL_FAR);
+	}
+
+	// os eventos da posicao atual vencem
+	slot = (int)(now & (TWHL_SLOTS - 1));
+	while ((handle = w->head[slot]) >= 0)
+	{
+		twhlUnlink(w, handle);
+		twhlLink(w, TWHL_DUE, handle);
+	}
+	w->now = now + 1;
+}
+
+/**
+ * @brief Funcao que inicializa uma roda de tempo vazia
+ *
+ * @param w roda de tempo
+ * @param now instante inicial
+ */
+void twhlInit(TimeWheel *w, long long now)
+{
+	int i;
+
+	for (i = 0; i <= TWHL_FAR; i++)
+		w->head[i] = -1;
+	w->next = w->prev = w->list = w->kind = NULL;
+	w->when = NULL;
+	w->capacity = 0;
+	w->now = now;
+	w->count = 0;
+	w->cascaded = 0;
+}
+
+/**
+ * @brief Funcao que libera a memoria de uma roda de tempo
+ *
+ * @param w roda de tempo
+ */
+void twhlFree(TimeWheel *w)
+{
+	free(w->next);
+	free(w->prev);
+	free(w->list);
+	free(w->kind);
+	free(w->when);
+	twhlInit(w, w->now);
+}
+
+/**
+ * @brief Funcao que agenda (ou reagenda) o evento de um handle em O(1)
+ *
+ * @param w roda de tempo
+ * @param handle handle do processo
+ * @param when instante do evento (instantes passados vencem no proximo twhlPop)
+ * @param kind tipo do evento
+ */
+void twhlSchedule(TimeWheel *w, int handle, long long when, int kind)
+{
+	twhlReserve(w, handle);
+	if (w->list[handle] >= 0) // substitui o evento anterior
+		twhlUnlink(w, handle);
+	else
+		w->count++;
+	w->when[handle] = when;
+	w->kind[handle] = kind;
+	twhlPlace(w, handle);
+}
+
+/**
+ * @brief Funcao que cancela o evento pendente de um handle em O(1)
+ *
+ * @param w roda de tempo
+ * @param handle handle do processo
+ */
+void twhlCancel(TimeWheel *w, int handle)
+{
+	if (handle >= w->capacity || w->list[handle] < 0)
+		return;
+	twhlUnlink(w, handle);
+	w->count--;
+}
+
+/**
+ * @brief Funcao que retira um evento vencido ate um instante, avancando a roda
+ *
+ * @param w roda de tempo
+ * @param now instante atual
+ * @param kind saida com o tipo do evento
+ * @return int handle do evento ou -1, caso nenhum evento tenha vencido
+ */
+int twhlPop(TimeWheel *w, long long now, int *kind)
+{
+	int handle;
+
+	while (w->head[TWHL_DUE] < 0 && w->now <= now)
+	{
+		if (w->count == 0) // roda vazia: salta direto para o instante
+		{
+			w->now = now + 1;
+			return -1;
+		}
+		twhlTick(w);
+	}
+	if ((handle = w->head[TWHL_DUE]) < 0)
+		return -1;
+	twhlUnlink(w, handle);
+	w->count--;
+	*kind = w->kind[handle];
+	return handle;
+}
+
+/**
+ * @brief Funcao que retorna o tipo do evento pendente de um handle
+ *
+ * @param w roda de tempo
+ * @param handle handle do processo
+ * @return int tipo do evento ou -1, caso o handle nao tenha evento
+ */
+int twhlPending(TimeWheel *w, int handle)
+{
+	return handle < w->capacity && w->list[handle] >= 0 ? w->kind[handle] : -1;
+}
+
+/**
+ * @brief Funcao que retorna quantos eventos estao pendentes
+ *
+ * @param w roda de tempo
+ * @return int eventos pendentes
+ */
+int twhlCount(TimeWheel *w)
+{
+	return w->count;
+}
+
+/**
+ * @brief Funcao que retorna quantos eventos foram redistribuidos entre niveis
+ *
+ * @param w roda de tempo
+ * @return long eventos redistribuidos
+ */
+long twhlGetCascaded(TimeWheel *w)
+{
+	return w->cascaded;
+}
+
+// cabecalho da roda no instantaneo
+typedef struct twhl_snap_info
+{
+	int64_t now;	  // proximo instante a ser processado
+	int64_t cascaded; // eventos redistribuidos
+	int32_t capacity; // handles alocados
+	int32_t count;	  // eventos pendentes
+} TwhlSnapInfo;
+
+/**
+ * @brief Funcao que grava a roda no instantaneo (listas e colunas por handle, como estao)
+ *
+ * @param w roda de tempo
+ * @param s instantaneo em gravacao
+ */
+void twhlSave(TimeWheel *w, Snapshot *s)
+{
+	TwhlSnapInfo info = {w->now, w->cascaded, w->capacity, w->count};
+
+	snapBeginSection(s, SNAP_SEC_WHEEL);
+	snapWrite(s, &info, sizeof(info));
+	snapWrite(s, w->head, sizeof(w->head));
+	snapWrite(s, w->next, w->capacity * sizeof(int));
+	snapWrite(s, w->prev, w->capacity * sizeof(int));
+	snapWrite(s, w->list, w->capacity * sizeof(int));
+	snapWrite(s, w->kind, w->capacity * sizeof(int));
+	snapWrite(s, w->when, w->capacity * sizeof(long long));
+}
+
+/**
+ * @brief Funcao que restaura uma roda gravada por twhlSave, sem reagendar os eventos
+ *
+ * @param w roda de tempo (substituida)
+ * @param s instantaneo aberto
+ * @return int 1 caso a roda seja restaurada e 0, caso contrario
+ */
+int twhlLoad(TimeWheel *w, Snapshot *s)
+{
+	const TwhlSnapInfo *info;
+	const int *head, *next, *prev, *list, *kind;
+	const long long *when;
+	int i;
+
+	if (!snapSeek(s, SNAP_SEC_WHEEL) || (info = snapRead(s, sizeof(TwhlSnapInfo))) == NULL)
+		return 0;
+	if (info->capacity < 0 || info->count < 0 || info->count > info->capacity)
+		return 0;
+	head = snapRead(s, sizeof(w->head));
+	next = snapRead(s, info->capacity * sizeof(int));
+	prev = snapRead(s, info->capacity * sizeof(int));
+	list = snapRead(s, info->capacity * sizeof(int));
+	kind = snapRead(s, info->capacity * sizeof(int));
+	when = snapRead(s, info->capacity * sizeof(long long));
+	if (s->error)
+		return 0;
+	for (i = 0; i <= TWHL_FAR; i++) // encadeamentos dentro dos handles gravados
+		if (head[i] < -1 || head[i] >= info->capacity)
+			return 0;
+	for (i = 0; i < info->capacity; i++) // encadeamentos de handles sem evento nao sao usados
+		if (list[i] < -1 || list[i] > TWHL_FAR ||
+			(list[i] >= 0 && (next[i] < -1 || next[i] >= info->capacity || prev[i] < -1 || prev[i] >= info->capacity)))
+			return 0;
+
+	twhlFree(w);
+	twhlReserve(w, info->capacity - 1);
+	memcpy(w->head, head, sizeof(w->head));
+	memcpy(w->next, next, info->capacity * sizeof(int));
+	memcpy(w->prev, prev, info->capacity * sizeof(int));
+	memcpy(w->list, list, info->capacity * sizeof(int));
+	memcpy(w->kind, kind, info->capacity * sizeof(int));
+	memcpy(w->when, when, info->capacity * sizeof(long long));
+	w->now = info->now;
+	w->count = info->count;
+	w->cascaded = info->cascaded;
+	return 1;
+}
@@ -0,0 +1,119 @@
+#ifndef TIMEWHEEL_H
+#define TIMEWHEEL_H
+
+#include "snapshot.h"
+
+/*
+ * Roda de tempo hierarquica (Varghese e Lauck): cada nivel tem TWHL_SLOTS
+ * posicoes e cobre TWHL_SLOTS vezes o intervalo do nivel de baixo. Agendar e
+ * cancelar custam O(1); avancar um instante so percorre a posicao vencida do
+ * primeiro nivel e, quando ela da a volta, redistribui uma posicao do nivel
+ * de cima. Cada handle de processo tem no maximo um evento pendente.
+ */
+
+#define TWHL_BITS 8						  // bits do instante por nivel
+#define TWHL_SLOTS (1 << TWHL_BITS)		  // posicoes por nivel
+#define TWHL_LEVELS 4					  // niveis (alcance de 2^32 instantes)
+#define TWHL_DUE (TWHL_LEVELS * TWHL_SLOTS) // lista dos eventos vencidos
+#define TWHL_FAR (TWHL_DUE + 1)			  // lista dos eventos alem do ultimo nivel
+
+typedef struct time_wheel
+{
+        int head[TWHL_FAR + 1]; // primeiro evento de cada lista (posicoes, vencidos e distantes)
+        int *next;              // proximo evento da lista, por handle
+        int *prev;              // evento anterior da lista, por handle
+        int *list;              // lista do evento de cada handle ou -1, caso nao tenha evento
+        int *kind;              // tipo do evento de cada handle
+        long long *when;        // instante do evento de cada handle
+        int capacity;           // handles alocados
+        long long now;          // proximo instante a ser processado
+        int count;              // eventos pendentes
+        long cascaded;          // eventos redistribuidos entre niveis
+} TimeWheel;
+
+/**
+ * @brief Funcao que inicializa uma roda de tempo vazia
+ *
+ * @param w roda de tempo
+ * @param now instante inicial
+ */
+void twhlInit(TimeWheel *w, long long now);
+
+/**
+ * @brief Funcao que libera a memoria de uma roda de tempo
+ *
+ * @param w roda de tempo
+ */
+void twhlFree(TimeWheel *w);
+
+/**
+ * @brief Funcao que agenda (ou reagenda) o evento de um handle em O(1)
+ *
+ * @param w roda de tempo
+ * @param handle handle do processo
+ * @param when instante do evento (instantes passados vencem no proximo twhlPop)
+ * @param kind tipo do evento
+ */
+void twhlSchedule(TimeWheel *w, int handle, long long when, int kind);
+
+/**
+ * @brief Funcao que cancela o evento pendente de um handle em O(1)
+ *
+ * @param w roda de tempo
+ * @param handle handle do processo
+ */
+void twhlCancel(TimeWheel *w, int handle);
+
+/**
+ * @brief Funcao que retira um evento vencido ate um instante, avancando a roda
+ *
+ * @param w roda de tempo
+ * @param now instante atual
+ * @param kind saida com o tipo do evento
+ * @return int handle do evento ou -1, caso nenhum evento tenha vencido
+ */
+int twhlPop(TimeWheel *w, long long now, int *kind);
+
+/**
+ * @brief Funcao que retorna o tipo do evento pendente de um handle
+ *
+ * @param w roda de tempo
+ * @param handle handle do processo
+ * @return int tipo do evento ou -1, caso o handle nao tenha evento
+ */
+int twhlPending(TimeWheel *w, int handle);
+
+/**
+ * @brief Funcao que retorna quantos eventos estao pendentes
+ *
+ * @param w roda de tempo
+ * @return int eventos pendentes
+ */
+int twhlCount(TimeWheel *w);
+
+/**
+ * @brief Funcao que retorna quantos eventos foram redistribuidos entre niveis
+ *
+ * @param w roda de tempo
+ * @return long eventos redistribuidos
+ */
+long twhlGetCascaded(TimeWheel *w);
+
+/**
+ * @brief Funcao que grava a roda no instantaneo (listas e colunas por handle, como estao)
+ *
+ * @param w roda de tempo
+ * @param s instantaneo em gravacao
+ */
+void twhlSave(TimeWheel *w, Snapshot *s);
+
+/**
+ * @brief Funcao que restaura uma roda gravada por twhlSave, sem reagendar os eventos
+ *
+ * @param w roda de tempo (substituida)
+ * @param s instantaneo aberto
+ * @return int 1 caso a roda seja restaurada e 0, caso contrario
+ */
+int twhlLoad(TimeWheel *w, Snapshot *s);
+
+#endif
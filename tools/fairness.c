@@ -0,0 +1,328 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../process.h"
+#include "../scheduler.h"
+#include "../lottery.h"
+#include "../alias.h"
+#include "../stride.h"
+
+/*
+ * Verificacao estatistica da justica dos escalonadores registrados: cada
+ * algoritmo realiza muitos sorteios sobre um conjunto fixo de processos
+ * prontos e o uso de CPU (cpu_usage) de cada processo eh comparado com a
+ * fracao esperada dos seus tickets, pelos testes qui-quadrado e de
+ * Kolmogorov-Smirnov e pela taxa de convergencia do desvio. Os sorteios sao
+ * divididos entre processos filhos (fork), com sementes diferentes, e nada eh
+ * impresso durante os sorteios. Compilar a partir da raiz do projeto:
+ *
+ *   gcc -O2 -o fairness tools/fairness.c alias.c lottery.c pool.c process.c \
+ *       proctable.c rng.c scheduler.c snapshot.c stride.c ticketindex.c ticketkernels.c trace.c -pthread -lm
+ *   ./fairness [--sorteios N] [--processos N] [--trabalhadores N] [--limite d] [--alfa p]
+ *
+ * O codigo de saida eh 1 quando algum escalonador eh reprovado.
+ */
+
+#define FAIR_MAX_SLOTS 4		// slots de escalonadores percorridos
+#define FAIR_MAX_PROCS 1024		// processos no conjunto
+#define FAIR_MAX_WORKERS 256	// processos filhos
+#define FAIR_CHECKPOINTS 8		// pontos da curva de convergencia (potencias de 10 ate o total)
+
+long long fairDraws = 200000000; // sorteios por escalonador
+int fairProcs = 32;				 // processos prontos
+int fairWorkers = 0;			 // processos filhos (0 para um por CPU)
+double fairLimit = 5.0;			 // desvio maximo aceito, em desvios padrao da binomial
+double fairAlpha = 1e-6;		 // nivel de significancia do qui-quadrado
+
+/**
+ * @brief Funcao que retorna os tickets do processo i: pesos de 1 a 100 vezes o menor
+ *
+ * @param i indice do processo
+ * @return int64_t tickets
+ */
+static int64_t fairTickets(int i)
+{
+	return 10 + (int64_t)i * 990 / (fairProcs > 1 ? fairProcs - 1 : 1);
+}
+
+/**
+ * @brief Funcao executada em cada processo filho: realiza os sorteios e escreve as contagens no pipe
+ *
+ * A cada ponto da curva de convergencia as contagens acumuladas sao escritas.
+ *
+ * @param si escalonador
+ * @param draws sorteios deste filho
+ * @param seed semente
+ * @param checkpoints sorteios acumulados de cada ponto
+ * @param fd pipe de saida
+ */
+static void fairWorker(SchedInfo *si, long long draws, uint64_t seed, const long long *checkpoints, int fd)
+{
+	Process *procs[FAIR_MAX_PROCS], *plist = NULL, *running = NULL;
+	long long counts[FAIR_MAX_PROCS], d;
+	LotterySchedParams *params;
+	int i, c = 0;
+
+	lottSetSeed(seed);
+	aliasSetSeed(seed);
+	for (i = 0; i < fairProcs; i++)
+	{
+		procs[i] = plist = processCreate(plist);
+		params = lottAllocParams();
+		params->num_tickets = fairTickets(i);
+		si->initParamsFn(plist, params);
+		processSetStatus(plist, PROC_READY);
+	}
+
+	for (d = 1; d <= draws; d++)
+	{
+		if (running != NULL)
+			processSetStatus(running, PROC_READY);
+		running = si->scheduleFn(plist);
+		if (running != NULL)
+		{
+			processSetStatus(running, PROC_RUNNING);
+			processAddCpuUsage(running, 1);
+		}
+		if (d == checkpoints[c]) // contagens acumuladas ate aqui
+		{
+			for (i = 0; i < fairProcs; i++)
+				counts[i] = processGetCpuUsage(procs[i]);
+			if (write(fd, counts, fairProcs * sizeof(long long)) < 0)
+				_exit(1);
+			c++;
+		}
+	}
+	_exit(0);
+}
+
+/**
+ * @brief Funcao que le exatamente n bytes de um pipe
+ *
+ * @param fd pipe
+ * @param buf destino
+ * @param n bytes
+ * @return int 1 caso todos os bytes sejam lidos e 0, caso contrario
+ */
+static int readAll(int fd, void *buf, size_t n)
+{
+	ssize_t got;
+	while (n > 0)
+	{
+		got = read(fd, buf, n);
+		if (got <= 0)
+			return 0;
+		buf = (char *)buf + got;
+		n -= got;
+	}
+	return 1;
+}
+
+/**
+ * @brief Funcao que retorna o maior desvio relativo entre o uso observado e o esperado
+ *
+ * @param counts uso de cada processo
+ * @param expected fracao esperada de cada processo
+ * @param total sorteios
+ * @return double desvio relativo maximo
+ */
+static double maxDeviation(const long long *counts, const double *expected, long long total)
+{
+	double dev, worst = 0;
+	int i;
+	for (i = 0; i < fairProcs; i++)
+	{
+		dev = fabs(counts[i] / (expected[i] * total) - 1.0);
+		if (dev > worst)
+			worst = dev;
+	}
+	return worst;
+}
+
+/**
+ * @brief Funcao que retorna o maior desvio em desvios padrao da binomial de cada processo
+ *
+ * @param counts uso de cada processo
+ * @param expected fracao esperada de cada processo
+ * @param total sorteios
+ * @return double maior |z|
+ */
+static double maxZScore(const long long *counts, const double *expected, long long total)
+{
+	double z, worst = 0;
+	int i;
+	for (i = 0; i < fairProcs; i++)
+	{
+		z = fabs(counts[i] - expected[i] * total) / sqrt(total * expected[i] * (1 - expected[i]));
+		if (z > worst)
+			worst = z;
+	}
+	return worst;
+}
+
+/**
+ * @brief Funcao que retorna a probabilidade da cauda superior do qui-quadrado (aproximacao de Wilson-Hilferty)
+ *
+ * @param chi2 estatistica
+ * @param df graus de liberdade
+ * @return double valor-p
+ */
+static double chiSquarePValue(double chi2, int df)
+{
+	double v = 2.0 / (9.0 * df);
+	double z = (cbrt(chi2 / df) - (1.0 - v)) / sqrt(v);
+	return 0.5 * erfc(z / sqrt(2.0));
+}
+
+/**
+ * @brief Funcao que mede a justica de um escalonador e imprime o resultado
+ *
+ * @param si escalonador
+ * @return int 1 caso o escalonador seja aprovado e 0, caso contrario
+ */
+static int fairRun(SchedInfo *si)
+{
+	long long checkpoints[FAIR_CHECKPOINTS + 1], totals[FAIR_CHECKPOINTS];
+	long long counts[FAIR_CHECKPOINTS][FAIR_MAX_PROCS], part[FAIR_MAX_PROCS];
+	double expected[FAIR_MAX_PROCS], devs[FAIR_CHECKPOINTS];
+	double sumTickets = 0, chi2 = 0, ks = 0, cumObs = 0, cumExp = 0, diff, pvalue, slope, zmax;
+	double sx = 0, sy = 0, sxx = 0, sxy = 0, x, y, seconds;
+	int fds[FAIR_MAX_WORKERS], numCheck, i, w, c, ok = 1, status;
+	long long perWorker = fairDraws / fairWorkers, step;
+	struct timespec start, end;
+	pid_t pid;
+
+	// pontos de convergencia por filho: potencias de 10 e o total
+	for (numCheck = 0, step = 1000; step < perWorker && numCheck < FAIR_CHECKPOINTS - 1; step *= 10)
+		checkpoints[numCheck++] = step;
+	checkpoints[numCheck++] = perWorker;
+	checkpoints[numCheck] = -1;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (w = 0; w < fairWorkers; w++)
+	{
+		int p[2];
+		if (pipe(p) < 0)
+			return 0;
+		pid = fork();
+		if (pid == 0)
+		{
+			close(p[0]);
+			fairWorker(si, perWorker, 0x5EED0000ULL + w, checkpoints, p[1]);
+		}
+		close(p[1]);
+		fds[w] = p[0];
+	}
+
+	memset(counts, 0, sizeof(counts));
+	for (w = 0; w < fairWorkers; w++) // soma as contagens de todos os filhos
+	{
+		for (c = 0; c < numCheck; c++)
+		{
+			if (!readAll(fds[w], part, fairProcs * sizeof(long long)))
+			{
+				fprintf(stderr, "%s: filho %d falhou\n", si->name, w);
+				ok = 0;
+				break;
+			}
+			for (i = 0; i < fairProcs; i++)
+				counts[c][i] += part[i];
+		}
+		close(fds[w]);
+	}
+	while (wait(&status) > 0)
+		;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	if (!ok)
+		return 0;
+
+	for (i = 0; i < fairProcs; i++)
+		sumTickets += fairTickets(i);
+	for (i = 0; i < fairProcs; i++)
+		expected[i] = fairTickets(i) / sumTickets;
+
+	// desvio em cada ponto e inclinacao de log(desvio) x log(sorteios), esperada perto de -0,5
+	for (c = 0; c < numCheck; c++)
+	{
+		totals[c] = checkpoints[c] * fairWorkers;
+		devs[c] = maxDeviation(counts[c], expected, totals[c]);
+		x = log((double)totals[c]);
+		y = log(devs[c] > 0 ? devs[c] : 1e-12);
+		sx += x;
+		sy += y;
+		sxx += x * x;
+		sxy += x * y;
+	}
+	slope = numCheck > 1 ? (numCheck * sxy - sx * sy) / (numCheck * sxx - sx * sx) : 0;
+
+	// qui-quadrado e Kolmogorov-Smirnov sobre as contagens finais
+	c = numCheck - 1;
+	for (i = 0; i < fairProcs; i++)
+	{
+		diff = counts[c][i] - expected[i] * totals[c];
+		chi2 += diff * diff / (expected[i] * totals[c]);
+		cumObs += (double)counts[c][i] / totals[c];
+		cumExp += expected[i];
+		if (fabs(cumObs - cumExp) > ks)
+			ks = fabs(cumObs - cumExp);
+	}
+	pvalue = chiSquarePValue(chi2, fairProcs - 1);
+	zmax = maxZScore(counts[c], expected, totals[c]);
+	ok = zmax <= fairLimit && pvalue >= fairAlpha;
+
+	printf("%s: %lld sorteios em %.2f s (%.0f/s, %d filhos)\n", si->name, totals[c], seconds, totals[c] / seconds,
+		   fairWorkers);
+	printf("  qui-quadrado %.2f (gl %d, p %.3g); KS D %.3g (sqrt(n) D %.3f)\n", chi2, fairProcs - 1, pvalue, ks,
+		   sqrt((double)totals[c]) * ks);
+	printf("  desvio relativo maximo %.5f (%.2f desvios padrao); convergencia: desvio ~ n^%.2f\n", devs[c], zmax,
+		   slope);
+	for (i = 0; i < numCheck; i++)
+		printf("    n=%-12lld desvio %.5f\n", totals[i], devs[i]);
+	printf("  %s\n", ok ? "APROVADO" : "REPROVADO");
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	SchedInfo *si;
+	int slot, i, failed = 0;
+
+	for (i = 1; i + 1 < argc; i += 2)
+	{
+		if (!strcmp(argv[i], "--sorteios"))
+			fairDraws = atoll(argv[i + 1]);
+		else if (!strcmp(argv[i], "--processos"))
+			fairProcs = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--trabalhadores"))
+			fairWorkers = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--limite"))
+			fairLimit = atof(argv[i + 1]);
+		else if (!strcmp(argv[i], "--alfa"))
+			fairAlpha = atof(argv[i + 1]);
+	}
+	if (fairWorkers <= 0)
+		fairWorkers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (fairWorkers > FAIR_MAX_WORKERS)
+		fairWorkers = FAIR_MAX_WORKERS;
+	if (fairProcs < 2 || fairProcs > FAIR_MAX_PROCS || fairDraws < fairWorkers)
+	{
+		fprintf(stderr, "Configuracao invalida\n");
+		return 2;
+	}
+
+	schedInitSchedInfo();
+	lottInitSchedInfo();
+	aliasInitSchedInfo();
+	strdInitSchedInfo();
+	lottSetVerbose(0);
+	schedSetLatencyTracking(0);
+
+	for (slot = 0; slot < FAIR_MAX_SLOTS && (si = schedGetSchedInfo(slot)) != NULL; slot++)
+		failed += !fairRun(si);
+	return failed ? 1 : 0;
+}
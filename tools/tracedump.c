@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "../trace.h"
+#include "../workload.h"
+#include "../process.h"
+
+/*
+ * Decodificador dos rastros binarios gravados com --rastro e com --gravar
+ * (carga): imprime um evento por linha. Compilar a partir da raiz do projeto:
+ *
+ *   gcc -O2 -o tracedump tools/tracedump.c workload.c
+ */
+
+/**
+ * @brief Funcao que retorna o nome de um estado de processo
+ *
+ * @param status estado
+ * @return const char* nome
+ */
+static const char *statusName(int64_t status)
+{
+	switch (status)
+	{
+	case PROC_INITIALIZING:
+		return "INICIALIZANDO";
+	case PROC_WAITING:
+		return "AGUARDANDO";
+	case PROC_READY:
+		return "PRONTO";
+	case PROC_RUNNING:
+		return "EXECUTANDO";
+	case PROC_TERMINATING:
+		return "TERMINADO";
+	default:
+		return "?";
+	}
+}
+
+/**
+ * @brief Funcao que imprime um evento
+ *
+ * @param e evento
+ */
+static void printEvent(const TraceEvent *e)
+{
+	printf("%14.6f ms ", e->timestamp / 1e6);
+	switch (e->type)
+	{
+	case TRACE_DRAW:
+		printf("SORTEIO      cpu %u bilhete %" PRId64 " de %" PRId64 " -> pid %d\n", e->cpu, e->a, e->b, e->pid);
+		break;
+	case TRACE_SCHED:
+		printf("ESCALONA     cpu %u pid %" PRId64 " -> pid %d\n", e->cpu, e->a, e->pid);
+		break;
+	case TRACE_STATUS:
+		printf("ESTADO       pid %d %s -> %s\n", e->pid, statusName(e->a), statusName(e->b));
+		break;
+	case TRACE_TRANSFER:
+		printf("TRANSFERE    pid %d -> pid %" PRId64 " %" PRId64 " tickets\n", e->pid, e->a, e->b);
+		break;
+	default:
+		printf("DESCONHECIDO tipo %u\n", e->type);
+	}
+}
+
+/**
+ * @brief Funcao que imprime os eventos de um rastro de carga
+ *
+ * @param path caminho do arquivo
+ * @return int 0 caso o rastro seja lido por completo e 1, caso contrario
+ */
+static int dumpWorkload(const char *path)
+{
+	static const char *names[] = {"?", "CRIA", "REMOVE", "BLOQUEIA", "DESBLOQUEIA", "TRANSFERE", "QUANTA"};
+	WorkloadTrace t;
+	WorkloadEvent e;
+	long count = 0;
+	int status;
+
+	if (!wkldOpen(&t, path))
+	{
+		fprintf(stderr, "Versao do rastro de carga nao suportada\n");
+		return 1;
+	}
+	printf("Carga: %u CPUs; %" PRIu64 " eventos; maior PID %d\n", t.header.cpus, t.header.events, t.header.max_pid);
+	while ((status = wkldNext(&t, &e)) > 0)
+	{
+		if (e.type == WKLD_QUANTUM)
+			printf("%-12s %" PRId64 "\n", names[e.type], e.value);
+		else if (e.type == WKLD_TRANSFER)
+			printf("%-12s pid %d -> pid %d %" PRId64 " tickets\n", names[e.type], e.pid, e.dst, e.value);
+		else
+			printf("%-12s pid %d %" PRId64 "\n", names[e.type], e.pid, e.value);
+		count++;
+	}
+	printf("Eventos: %ld\n", count);
+	wkldClose(&t);
+	if (status < 0)
+		fprintf(stderr, "Rastro de carga corrompido apos %ld eventos\n", count);
+	else if (t.unfinished) // gravacao interrompida antes de completar o cabecalho
+		fprintf(stderr, "Rastro de carga incompleto: cabecalho nao completado; %ld eventos gravados\n", count);
+	else if ((uint64_t)count != t.header.events) // arquivo cortado depois da gravacao
+		fprintf(stderr, "Rastro de carga incompleto: %ld de %" PRIu64 " eventos\n", count, t.header.events);
+	return status < 0;
+}
+
+int main(int argc, char *argv[])
+{
+	TraceHeader header = {0, 0, 0};
+	TraceEvent e;
+	long count = 0;
+	FILE *f;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "Uso: %s arquivo\n", argv[0]);
+		return 1;
+	}
+	f = fopen(argv[1], "rb");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Nao foi possivel abrir %s\n", argv[1]);
+		return 1;
+	}
+
+	if (fread(&header, sizeof(header), 1, f) == 1 && header.magic == WKLD_MAGIC) // rastro de carga
+	{
+		fclose(f);
+		return dumpWorkload(argv[1]);
+	}
+	if (header.magic != TRACE_MAGIC)
+	{
+		fprintf(stderr, "%s nao eh um rastro\n", argv[1]);
+		fclose(f);
+		return 1;
+	}
+	if (header.version != TRACE_VERSION || header.event_size != sizeof(TraceEvent))
+	{
+		fprintf(stderr, "Versao %u do rastro nao suportada\n", header.version);
+		fclose(f);
+		return 1;
+	}
+
+	while (fread(&e, sizeof(e), 1, f) == 1)
+	{
+		printEvent(&e);
+		count++;
+	}
+	printf("Eventos: %ld\n", count);
+	fclose(f);
+	return 0;
+}
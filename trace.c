@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include "trace.h"
+
+#define TRACE_DRAIN_SLEEP_NS 100000 // espera do escoamento com os buffers vazios (100 us)
+
+// buffer circular de uma thread: um produtor (a thread) e um consumidor (o escoamento)
+typedef struct trace_ring
+{
+	TraceEvent events[TRACE_RING_SIZE];
+	_Atomic uint64_t head;	 // proximo evento a ser escrito (so a thread dona altera)
+	_Atomic uint64_t tail;	 // proximo evento a ser gravado (so o escoamento altera)
+	struct trace_ring *next; // proximo buffer da lista
+} TraceRing;
+
+volatile int traceEnabled = 0;
+
+static _Atomic(TraceRing *) traceRings = NULL; // buffers de todas as threads (insercao sem trava)
+static __thread TraceRing *traceLocal = NULL;  // buffer da thread atual
+static atomic_long traceDropped = 0;		   // eventos descartados por buffer cheio
+static atomic_int traceRunning = 0;			   // 1 enquanto o escoamento deve continuar
+static FILE *traceFile = NULL;
+static pthread_t traceDrainer;
+static struct timespec traceEpoch; // instante de traceStart
+
+/**
+ * @brief Funcao que retorna o buffer da thread atual, criando-o no primeiro evento
+ *
+ * Os buffers nunca sao liberados: a lista so cresce com o numero de threads
+ * e o escoamento pode percorre-la sem trava.
+ *
+ * @return TraceRing* buffer ou NULL, caso falte memoria
+ */
+static TraceRing *traceGetRing(void)
+{
+	TraceRing *ring = traceLocal;
+
+	if (ring == NULL)
+	{
+		ring = calloc(1, sizeof(TraceRing));
+		if (ring == NULL)
+			return NULL;
+		ring->next = atomic_load(&traceRings);
+		while (!atomic_compare_exchange_weak(&traceRings, &ring->next, ring)) // insere no inicio da lista
+			;
+		traceLocal = ring;
+	}
+	return ring;
+}
+
+/**
+ * @brief Funcao que grava no arquivo os eventos pendentes de todos os buffers
+ *
+ * @return long quantidade de eventos gravados
+ */
+static long traceDrainRings(void)
+{
+	TraceRing *ring;
+	uint64_t head, tail, n, pos;
+	long written = 0;
+
+	for (ring = atomic_load(&traceRings); ring != NULL; ring = ring->next)
+	{
+		head = atomic_load_explicit(&ring->head, memory_order_acquire);
+		tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+		while (tail < head) // grava em trechos contiguos do buffer
+		{
+			pos = tail & (TRACE_RING_SIZE - 1);
+			n = head - tail;
+			if (n > TRACE_RING_SIZE - pos)
+				n = TRACE_RING_SIZE - pos;
+			fwrite(&ring->events[pos], sizeof(TraceEvent), n, traceFile);
+			tail += n;
+			written += n;
+		}
+		atomic_store_explicit(&ring->tail, tail, memory_order_release); // libera as posicoes para a thread
+	}
+	return written;
+}
+
+/**
+ * @brief Funcao da thread de escoamento: grava os eventos ate o rastreamento ser desligado
+ *
+ * @param arg nao utilizado
+ * @return void* NULL
+ */
+static void *traceDrainLoop(void *arg)
+{
+	struct timespec pause = {0, TRACE_DRAIN_SLEEP_NS};
+	(void)arg;
+
+	while (atomic_load(&traceRunning))
+		if (traceDrainRings() == 0) // nada pendente, espera um pouco
+			nanosleep(&pause, NULL);
+	traceDrainRings(); // eventos emitidos antes do desligamento
+	return NULL;
+}
+
+/**
+ * @brief Funcao que liga o rastreamento, gravando os eventos em um arquivo por uma thread de escoamento
+ *
+ * @param path caminho do arquivo
+ * @return int 1 caso o rastreamento seja ligado e 0, caso contrario
+ */
+int traceStart(const char *path)
+{
+	TraceHeader header = {TRACE_MAGIC, TRACE_VERSION, sizeof(TraceEvent)};
+	TraceRing *ring;
+
+	if (traceFile != NULL) // ja ligado
+		return 0;
+	traceFile = fopen(path, "wb");
+	if (traceFile == NULL)
+		return 0;
+	fwrite(&header, sizeof(header), 1, traceFile);
+
+	// descarta eventos que sobraram de um rastreamento anterior
+	for (ring = atomic_load(&traceRings); ring != NULL; ring = ring->next)
+		atomic_store(&ring->tail, atomic_load(&ring->head));
+
+	clock_gettime(CLOCK_MONOTONIC, &traceEpoch);
+	atomic_store(&traceRunning, 1);
+	if (pthread_create(&traceDrainer, NULL, &traceDrainLoop, NULL) != 0)
+	{
+		atomic_store(&traceRunning, 0);
+		fclose(traceFile);
+		traceFile = NULL;
+		return 0;
+	}
+	traceEnabled = 1;
+	return 1;
+}
+
+/**
+ * @brief Funcao que desliga o rastreamento, esperando todos os eventos serem gravados
+ *
+ */
+void traceStop(void)
+{
+	if (traceFile == NULL)
+		return;
+	traceEnabled = 0;
+	atomic_store(&traceRunning, 0);
+	pthread_join(traceDrainer, NULL);
+	fclose(traceFile);
+	traceFile = NULL;
+}
+
+/**
+ * @brief Funcao que registra um evento no buffer circular da thread atual, sem bloquear
+ *
+ * @param type tipo do evento
+ * @param cpu CPU
+ * @param pid processo
+ * @param a primeiro valor
+ * @param b segundo valor
+ */
+void traceEmit(int type, int cpu, int pid, int64_t a, int64_t b)
+{
+	TraceRing *ring = traceGetRing();
+	TraceEvent *e;
+	struct timespec now;
+	uint64_t head;
+
+	if (ring == NULL)
+	{
+		atomic_fetch_add_explicit(&traceDropped, 1, memory_order_relaxed);
+		return;
+	}
+
+	head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= TRACE_RING_SIZE) // cheio, nao espera
+	{
+		atomic_fetch_add_explicit(&traceDropped, 1, memory_order_relaxed);
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	e = &ring->events[head & (TRACE_RING_SIZE - 1)];
+	e->timestamp = (uint64_t)(now.tv_sec - traceEpoch.tv_sec) * 1000000000ULL + now.tv_nsec - traceEpoch.tv_nsec;
+	e->type = (uint16_t)type;
+	e->cpu = (uint16_t)cpu;
+	e->pid = pid;
+	e->a = a;
+	e->b = b;
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release); // publica o evento
+}
+
+/**
+ * @brief Funcao que retorna quantos eventos foram descartados por buffer cheio
+ *
+ * @return long eventos descartados
+ */
+long traceGetDropped(void)
+{
+	return atomic_load(&traceDropped);
+}
@@ -0,0 +1,77 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_MAGIC 0x4352544CU // "LTRC" no inicio do arquivo
+#define TRACE_VERSION 1
+#define TRACE_RING_SIZE 65536 // eventos por buffer circular (potencia de 2, 2 MiB)
+
+// tipos de evento
+#define TRACE_DRAW 1     // sorteio: pid vencedor, a = bilhete, b = total de tickets
+#define TRACE_SCHED 2    // decisao do escalonador: pid escolhido, a = pid anterior na CPU
+#define TRACE_STATUS 3   // mudanca de estado: pid, a = estado anterior, b = novo estado
+#define TRACE_TRANSFER 4 // transferencia: pid origem, a = pid destino, b = tickets transferidos
+
+typedef struct trace_header
+{
+        uint32_t magic;      // TRACE_MAGIC
+        uint16_t version;    // TRACE_VERSION
+        uint16_t event_size; // sizeof(TraceEvent)
+} TraceHeader;
+
+typedef struct trace_event
+{
+        uint64_t timestamp; // nanossegundos desde traceStart
+        uint16_t type;      // tipo do evento
+        uint16_t cpu;       // CPU da decisao (0 para os demais eventos)
+        int32_t pid;        // processo principal do evento
+        int64_t a;          // primeiro valor (depende do tipo)
+        int64_t b;          // segundo valor (depende do tipo)
+} TraceEvent;
+
+extern volatile int traceEnabled; // 1 enquanto o rastreamento estiver ligado
+
+/**
+ * @brief Funcao que liga o rastreamento, gravando os eventos em um arquivo por uma thread de escoamento
+ *
+ * @param path caminho do arquivo
+ * @return int 1 caso o rastreamento seja ligado e 0, caso contrario
+ */
+int traceStart(const char *path);
+
+/**
+ * @brief Funcao que desliga o rastreamento, esperando todos os eventos serem gravados
+ *
+ */
+void traceStop(void);
+
+/**
+ * @brief Funcao que registra um evento no buffer circular da thread atual, sem bloquear
+ *
+ * Com o buffer cheio o evento eh descartado e contado.
+ *
+ * @param type tipo do evento
+ * @param cpu CPU
+ * @param pid processo
+ * @param a primeiro valor
+ * @param b segundo valor
+ */
+void traceEmit(int type, int cpu, int pid, int64_t a, int64_t b);
+
+/**
+ * @brief Funcao que retorna quantos eventos foram descartados por buffer cheio
+ *
+ * @return long eventos descartados
+ */
+long traceGetDropped(void);
+
+// ponto de rastreamento: com o rastreamento desligado custa apenas um teste
+#define TRACE(type, cpu, pid, a, b)                            \
+        do                                                     \
+        {                                                      \
+                if (__builtin_expect(traceEnabled, 0))         \
+                        traceEmit((type), (cpu), (pid), (a), (b)); \
+        } while (0)
+
+#endif
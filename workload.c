@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "workload.h"
+
+#define WKLD_BUFFER_SIZE 65536 // buffer de escrita
+#define WKLD_MAX_EVENT_SIZE 32 // maior evento codificado (tipo e tres inteiros de ate 10 bytes)
+
+int wkldRecording = 0;
+
+static FILE *wkldFile = NULL;
+static uint8_t wkldBuffer[WKLD_BUFFER_SIZE]; // eventos ainda nao escritos
+static size_t wkldUsed = 0;					 // bytes ocupados do buffer
+static WorkloadHeader wkldHeader;			 // cabecalho, completado no fim da gravacao
+static int wkldLastPid = 0;					 // PID do evento anterior
+static int64_t wkldPendingQuanta = 0;		 // quanta consecutivos ainda nao gravados
+static int wkldError = 0;					 // 1 caso alguma escrita falhe
+
+/**
+ * @brief Funcao que converte um inteiro com sinal para a forma sem sinal de magnitude (zigzag)
+ *
+ * @param v valor
+ * @return uint64_t valor codificado (0, -1, 1, -2... viram 0, 1, 2, 3...)
+ */
+static uint64_t wkldZigzag(int64_t v)
+{
+	return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+/**
+ * @brief Funcao que desfaz a codificacao zigzag
+ *
+ * @param v valor codificado
+ * @return int64_t valor
+ */
+static int64_t wkldUnzigzag(uint64_t v)
+{
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/**
+ * @brief Funcao que escreve um inteiro sem sinal com 7 bits por byte no buffer
+ *
+ * @param v valor
+ */
+static void wkldPutVarint(uint64_t v)
+{
+	while (v >= 0x80)
+	{
+		wkldBuffer[wkldUsed++] = (uint8_t)(v | 0x80); // ainda ha bytes
+		v >>= 7;
+	}
+	wkldBuffer[wkldUsed++] = (uint8_t)v;
+}
+
+/**
+ * @brief Funcao que escreve no arquivo o conteudo do buffer
+ *
+ */
+static void wkldFlush(void)
+{
+	if (wkldUsed > 0 && fwrite(wkldBuffer, 1, wkldUsed, wkldFile) != wkldUsed)
+		wkldError = 1;
+	wkldUsed = 0;
+}
+
+/**
+ * @brief Funcao que codifica um evento no buffer
+ *
+ * @param type tipo do evento
+ * @param pid processo
+ * @param dst processo de destino (transferencia)
+ * @param value valor
+ */
+static void wkldEncode(int type, int pid, int dst, int64_t value)
+{
+	if (wkldUsed > WKLD_BUFFER_SIZE - WKLD_MAX_EVENT_SIZE)
+		wkldFlush();
+	wkldBuffer[wkldUsed++] = (uint8_t)type;
+	if (type == WKLD_QUANTUM) // so a contagem
+	{
+		wkldPutVarint((uint64_t)value);
+		wkldHeader.events++;
+		return;
+	}
+
+	if (pid > WKLD_MAX_PID || dst > WKLD_MAX_PID) // a reproducao recusaria o rastro
+		wkldError = 1;
+	wkldPutVarint(wkldZigzag((int64_t)pid - wkldLastPid)); // diferenca para o evento anterior
+	wkldLastPid = pid;
+	if (pid > wkldHeader.max_pid)
+		wkldHeader.max_pid = pid;
+	if (type == WKLD_TRANSFER) // destino em relacao a origem
+	{
+		wkldPutVarint(wkldZigzag((int64_t)dst - pid));
+		if (dst > wkldHeader.max_pid)
+			wkldHeader.max_pid = dst;
+	}
+	if (type == WKLD_CREATE || type == WKLD_BLOCK || type == WKLD_TRANSFER)
+		wkldPutVarint(wkldZigzag(value));
+	wkldHeader.events++;
+}
+
+/**
+ * @brief Funcao que liga a gravacao da carga em um arquivo
+ *
+ * @param path caminho do arquivo
+ * @param cpus CPUs da simulacao
+ * @return int 1 caso a gravacao seja ligada e 0, caso contrario
+ */
+int wkldRecordStart(const char *path, int cpus)
+{
+	if (wkldFile != NULL) // ja ligada
+		return 0;
+	wkldFile = fopen(path, "wb");
+	if (wkldFile == NULL)
+		return 0;
+
+	memset(&wkldHeader, 0, sizeof(wkldHeader));
+	wkldHeader.magic = WKLD_MAGIC;
+	wkldHeader.version = WKLD_VERSION;
+	wkldHeader.cpus = (uint16_t)cpus;
+	fwrite(&wkldHeader, sizeof(wkldHeader), 1, wkldFile); // reescrito no fim
+	wkldUsed = 0;
+	wkldLastPid = 0;
+	wkldPendingQuanta = 0;
+	wkldError = 0;
+	wkldRecording = 1;
+	return 1;
+}
+
+/**
+ * @brief Funcao que grava um evento de carga (quanta consecutivos sao agrupados)
+ *
+ * @param type tipo do evento
+ * @param pid processo
+ * @param dst processo de destino (transferencia) ou 0
+ * @param value valor
+ */
+void wkldRecord(int type, int pid, int dst, int64_t value)
+{
+	if (wkldFile == NULL)
+		return;
+	if (type == WKLD_QUANTUM) // acumula ate o proximo evento de outro tipo
+	{
+		for (wkldPendingQuanta += value; wkldPendingQuanta >= WKLD_MAX_QUANTA; wkldPendingQuanta -= WKLD_MAX_QUANTA)
+			wkldEncode(WKLD_QUANTUM, 0, 0, WKLD_MAX_QUANTA); // contagem limitada por evento
+		return;
+	}
+	if (wkldPendingQuanta > 0)
+	{
+		wkldEncode(WKLD_QUANTUM, 0, 0, wkldPendingQuanta);
+		wkldPendingQuanta = 0;
+	}
+	wkldEncode(type, pid, dst, value);
+}
+
+/**
+ * @brief Funcao que desliga a gravacao, completando o cabecalho
+ *
+ * @return long eventos gravados ou -1, caso ocorra erro de escrita
+ */
+long wkldRecordStop(void)
+{
+	if (wkldFile == NULL)
+		return -1;
+	wkldRecording = 0;
+	if (wkldPendingQuanta > 0)
+		wkldEncode(WKLD_QUANTUM, 0, 0, wkldPendingQuanta);
+	wkldPendingQuanta = 0;
+	wkldFlush();
+	if (fseek(wkldFile, 0, SEEK_SET) != 0 || fwrite(&wkldHeader, sizeof(wkldHeader), 1, wkldFile) != 1)
+		wkldError = 1;
+	if (fclose(wkldFile) != 0)
+		wkldError = 1;
+	wkldFile = NULL;
+	return wkldError ? -1 : (long)wkldHeader.events;
+}
+
+/**
+ * @brief Funcao que percorre um rastro com o cabecalho nao completado, obtendo o maior PID gravado
+ *
+ * Os eventos terminam no ultimo evento completo (a gravacao pode ter parado no
+ * meio de uma escrita).
+ *
+ * @param t rastro
+ */
+static void wkldScan(WorkloadTrace *t)
+{
+	WorkloadEvent e;
+	const uint8_t *last;
+	int maxPid = 0;
+
+	t->header.max_pid = WKLD_MAX_PID; // limite do formato enquanto percorre
+	wkldRewind(t);
+	for (last = t->pos; wkldNext(t, &e) > 0; last = t->pos)
+	{
+		if (e.pid > maxPid)
+			maxPid = e.pid;
+		if (e.dst > maxPid)
+			maxPid = e.dst;
+	}
+	t->end = last;
+	t->header.max_pid = maxPid;
+}
+
+/**
+ * @brief Funcao que abre um rastro de carga, mapeando o arquivo em memoria
+ *
+ * @param t rastro
+ * @param path caminho do arquivo
+ * @return int 1 caso o rastro seja aberto e 0, caso contrario
+ */
+int wkldOpen(WorkloadTrace *t, const char *path)
+{
+	struct stat st;
+	void *data;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return 0;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(WorkloadHeader))
+	{
+		close(fd);
+		return 0;
+	}
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // o mapeamento continua valido
+	if (data == MAP_FAILED)
+		return 0;
+
+	memcpy(&t->header, data, sizeof(WorkloadHeader));
+	if (t->header.magic != WKLD_MAGIC || t->header.version != WKLD_VERSION || t->header.max_pid < 0 ||
+		t->header.max_pid > WKLD_MAX_PID)
+	{
+		munmap(data, (size_t)st.st_size);
+		return 0;
+	}
+	madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL); // leitura do inicio ao fim
+	t->data = data;
+	t->size = (size_t)st.st_size;
+	t->end = t->data + t->size;
+	t->unfinished = t->header.events == 0 && t->size > sizeof(WorkloadHeader);
+	if (t->unfinished)
+		wkldScan(t);
+	wkldRewind(t);
+	return 1;
+}
+
+/**
+ * @brief Funcao que le um inteiro sem sinal com 7 bits por byte
+ *
+ * @param pos posicao atual (avancada)
+ * @param end fim dos dados
+ * @param out saida com o valor
+ * @return int 1 caso o valor esteja completo e 0, caso contrario
+ */
+static int wkldGetVarint(const uint8_t **pos, const uint8_t *end, uint64_t *out)
+{
+	const uint8_t *p = *pos;
+	uint64_t v = 0;
+	int shift;
+
+	for (shift = 0; p < end && shift < 64; shift += 7)
+	{
+		v |= (uint64_t)(*p & 0x7F) << shift;
+		if (*p++ < 0x80) // ultimo byte
+		{
+			*pos = p;
+			*out = v;
+			return 1;
+		}
+	}
+	return 0; // truncado ou longo demais
+}
+
+/**
+ * @brief Funcao que decodifica o proximo evento do rastro
+ *
+ * @param t rastro
+ * @param e saida com o evento
+ * @return int 1 caso haja evento, 0 no fim do rastro e -1, caso o rastro esteja corrompido
+ */
+int wkldNext(WorkloadTrace *t, WorkloadEvent *e)
+{
+	const uint8_t *end = t->end;
+	uint64_t v;
+
+	if (t->pos >= end)
+		return 0;
+	e->type = *t->pos++;
+	e->pid = e->dst = 0;
+	e->value = 0;
+	if (e->type == WKLD_QUANTUM)
+	{
+		if (!wkldGetVarint(&t->pos, end, &v) || v > WKLD_MAX_QUANTA)
+			return -1;
+		e->value = (int64_t)v;
+		return 1;
+	}
+	if (e->type < WKLD_CREATE || e->type > WKLD_TRANSFER || !wkldGetVarint(&t->pos, end, &v))
+		return -1;
+
+	e->pid = t->last_pid = (int)(t->last_pid + wkldUnzigzag(v));
+	if (e->type == WKLD_TRANSFER)
+	{
+		if (!wkldGetVarint(&t->pos, end, &v))
+			return -1;
+		e->dst = (int)(e->pid + wkldUnzigzag(v));
+	}
+	if (e->type == WKLD_CREATE || e->type == WKLD_BLOCK || e->type == WKLD_TRANSFER)
+	{
+		if (!wkldGetVarint(&t->pos, end, &v))
+			return -1;
+		e->value = wkldUnzigzag(v);
+	}
+	if (e->pid < 0 || e->pid > t->header.max_pid || e->dst < 0 || e->dst > t->header.max_pid)
+		return -1; // fora do mapa de PIDs
+	if (e->type == WKLD_CREATE && e->value < 0)
+		return -1; // tickets negativos
+	return 1;
+}
+
+/**
+ * @brief Funcao que volta ao primeiro evento do rastro
+ *
+ * @param t rastro
+ */
+void wkldRewind(WorkloadTrace *t)
+{
+	t->pos = t->data + sizeof(WorkloadHeader);
+	t->last_pid = 0;
+}
+
+/**
+ * @brief Funcao que fecha um rastro de carga
+ *
+ * @param t rastro
+ */
+void wkldClose(WorkloadTrace *t)
+{
+	if (t->data != NULL)
+		munmap((void *)t->data, t->size);
+	t->data = NULL;
+	t->size = 0;
+}
@@ -0,0 +1,132 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Rastro de carga: as acoes da simulacao (criacao, remocao, bloqueio,
+ * desbloqueio, transferencia e fim de quantum) gravadas em formato binario
+ * compacto, para reproduzir a mesma carga com outro escalonador. Cada evento
+ * eh um byte de tipo seguido de inteiros de tamanho variavel (7 bits por byte);
+ * os PIDs sao gravados como diferenca em relacao ao evento anterior e quanta
+ * consecutivos viram um unico evento com a contagem. A leitura decodifica
+ * direto do arquivo mapeado em memoria, sem alocacoes.
+ */
+
+#define WKLD_MAGIC 0x4C4B574CU // "LWKL" no inicio do arquivo
+#define WKLD_VERSION 1
+#define WKLD_MAX_PID (1 << 24) // maior PID aceito (limita o mapa de PIDs da reproducao)
+#define WKLD_MAX_QUANTA 1000000 // quanta consecutivos em um unico evento
+
+// tipos de evento
+#define WKLD_CREATE 1   // criacao: pid, valor = tickets
+#define WKLD_DESTROY 2  // remocao: pid
+#define WKLD_BLOCK 3    // bloqueio: pid, valor = fracao usada do quantum (0 = quantum inteiro)
+#define WKLD_UNBLOCK 4  // desbloqueio: pid
+#define WKLD_TRANSFER 5 // transferencia: pid origem, dst = pid destino, valor = tickets
+#define WKLD_QUANTUM 6  // fim de quantum: valor = quanta consecutivos
+
+typedef struct workload_header
+{
+        uint32_t magic;   // WKLD_MAGIC
+        uint16_t version; // WKLD_VERSION
+        uint16_t cpus;    // CPUs da simulacao gravada
+        uint64_t events;  // eventos gravados
+        int32_t max_pid;  // maior PID gravado (dimensiona o mapa de PIDs da reproducao)
+        uint32_t reserved;
+} WorkloadHeader;
+
+typedef struct workload_event
+{
+        int type;      // tipo do evento
+        int pid;       // processo principal do evento
+        int dst;       // processo de destino (transferencia)
+        int64_t value; // valor (depende do tipo)
+} WorkloadEvent;
+
+// rastro mapeado em memoria
+typedef struct workload_trace
+{
+        WorkloadHeader header; // cabecalho
+        const uint8_t *data;   // arquivo mapeado
+        size_t size;           // tamanho do arquivo
+        const uint8_t *pos;    // proximo evento
+        const uint8_t *end;    // fim do ultimo evento completo
+        int last_pid;          // PID do evento anterior (base das diferencas)
+        int unfinished;        // 1 caso a gravacao tenha sido interrompida antes de completar o cabecalho
+} WorkloadTrace;
+
+extern int wkldRecording; // 1 enquanto a gravacao estiver ligada
+
+/**
+ * @brief Funcao que liga a gravacao da carga em um arquivo
+ *
+ * @param path caminho do arquivo
+ * @param cpus CPUs da simulacao
+ * @return int 1 caso a gravacao seja ligada e 0, caso contrario
+ */
+int wkldRecordStart(const char *path, int cpus);
+
+/**
+ * @brief Funcao que grava um evento de carga (quanta consecutivos sao agrupados)
+ *
+ * @param type tipo do evento
+ * @param pid processo
+ * @param dst processo de destino (transferencia) ou 0
+ * @param value valor
+ */
+void wkldRecord(int type, int pid, int dst, int64_t value);
+
+/**
+ * @brief Funcao que desliga a gravacao, completando o cabecalho
+ *
+ * @return long eventos gravados ou -1, caso ocorra erro de escrita
+ */
+long wkldRecordStop(void);
+
+/**
+ * @brief Funcao que abre um rastro de carga, mapeando o arquivo em memoria
+ *
+ * Se a gravacao foi interrompida antes de completar o cabecalho (zero eventos
+ * e maior PID 0 no arquivo com eventos), o maior PID eh obtido percorrendo os
+ * eventos, que terminam no ultimo evento completo, e unfinished fica 1.
+ *
+ * @param t rastro
+ * @param path caminho do arquivo
+ * @return int 1 caso o rastro seja aberto e 0, caso contrario
+ */
+int wkldOpen(WorkloadTrace *t, const char *path);
+
+/**
+ * @brief Funcao que decodifica o proximo evento do rastro
+ *
+ * @param t rastro
+ * @param e saida com o evento
+ * @return int 1 caso haja evento, 0 no fim do rastro e -1, caso o rastro esteja corrompido
+ */
+int wkldNext(WorkloadTrace *t, WorkloadEvent *e);
+
+/**
+ * @brief Funcao que volta ao primeiro evento do rastro
+ *
+ * @param t rastro
+ */
+void wkldRewind(WorkloadTrace *t);
+
+/**
+ * @brief Funcao que fecha um rastro de carga
+ *
+ * @param t rastro
+ */
+void wkldClose(WorkloadTrace *t);
+
+// ponto de gravacao: com a gravacao desligada custa apenas um teste
+#define WKLD_RECORD(type, pid, dst, value)                             \
+        do                                                             \
+        {                                                              \
+                if (__builtin_expect(wkldRecording, 0))                \
+                        wkldRecord((type), (pid), (dst), (value));     \
+        } while (0)
+
+#endif